@@ -0,0 +1,23 @@
+#ifndef BYTEORDER_HPP
+#define BYTEORDER_HPP
+
+#include <cstdint>
+#include <ostream>
+
+// Little-endian fields of 1 to 8 bytes, as used by every binary file the
+// simulator writes (memory access logs, result cache entries, execution
+// traces).
+
+inline void putLE(std::ostream& out, uint64_t value, int bytes) {
+    char buffer[8];
+    for (int i = 0; i < bytes; i++) buffer[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    out.write(buffer, bytes);
+}
+
+inline uint64_t getLE(const unsigned char* data, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    return value;
+}
+
+#endif
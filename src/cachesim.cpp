@@ -0,0 +1,113 @@
+#include "cachesim.hpp"
+#include "parsenumber.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+static bool isPowerOfTwo(uint32_t value) {
+    return value && !(value & (value - 1));
+}
+
+bool MultiCacheSimulator::add(const CacheConfig& config) {
+    if (!isPowerOfTwo(config.lineSize) || !isPowerOfTwo(config.sizeBytes) ||
+        config.sizeBytes < config.lineSize) return false;
+    if (config.associativity && (!isPowerOfTwo(config.associativity) || config.associativity > config.lines()))
+        return false;
+
+    size_t index = configs_.size();
+    configs_.push_back(config);
+    stats_.push_back(CacheStats());
+
+    for (Group& group : groups_) {
+        if (group.lineSize == config.lineSize && group.sets == config.sets()) {
+            group.members.push_back(index);
+            group.maxWays = std::max(group.maxWays, config.ways());
+            return true;
+        }
+    }
+
+    Group group;
+    group.lineSize = config.lineSize;
+    group.sets = config.sets();
+    group.maxWays = config.ways();
+    group.members.push_back(index);
+    group.stacks.resize(group.sets);
+    groups_.push_back(group);
+    return true;
+}
+
+void MultiCacheSimulator::addDefaultSweep() {
+    const uint32_t lineSizes[] = {4, 16, 32, 64};
+    const uint32_t associativities[] = {1, 2, 4, 0};
+    for (uint32_t size = 256; size <= 16384; size *= 2) {
+        for (uint32_t lineSize : lineSizes) {
+            for (uint32_t associativity : associativities) {
+                add(CacheConfig{size, associativity, lineSize});
+            }
+        }
+    }
+}
+
+void MultiCacheSimulator::access(uint32_t address) {
+    for (Group& group : groups_) {
+        uint32_t block = address / group.lineSize;
+        std::vector<uint32_t>& stack = group.stacks[block % group.sets];
+
+        auto it = std::find(stack.begin(), stack.end(), block);
+        size_t depth = it - stack.begin();
+        if (it == stack.end()) {
+            depth = group.maxWays;
+            if (stack.size() < group.maxWays) stack.push_back(block);
+            else stack.back() = block;
+            it = stack.end() - 1;
+        }
+        std::rotate(stack.begin(), it, it + 1);
+
+        for (size_t member : group.members) {
+            stats_[member].accesses++;
+            if (depth < configs_[member].ways()) stats_[member].hits++;
+        }
+    }
+}
+
+void MultiCacheSimulator::writeReport(std::ostream& out, const std::string& name) const {
+    out << "[" << name << "]\n";
+    out << "size_bytes,associativity,line_size,sets,accesses,hits,misses,miss_ratio\n";
+
+    std::vector<size_t> order(configs_.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        const CacheConfig& x = configs_[a];
+        const CacheConfig& y = configs_[b];
+        if (x.sizeBytes != y.sizeBytes) return x.sizeBytes < y.sizeBytes;
+        if (x.lineSize != y.lineSize) return x.lineSize < y.lineSize;
+        return x.ways() < y.ways();
+    });
+
+    for (size_t i : order) {
+        const CacheConfig& config = configs_[i];
+        const CacheStats& stats = stats_[i];
+        out << config.sizeBytes << ",";
+        if (config.associativity) out << config.associativity;
+        else out << "full";
+        out << "," << config.lineSize << "," << config.sets() << "," << stats.accesses << ","
+            << stats.hits << "," << stats.misses() << "," << stats.missRatio() << "\n";
+    }
+}
+
+bool parseCacheConfig(const std::string& spec, CacheConfig& config) {
+    std::vector<std::string> fields;
+    std::stringstream ss(spec);
+    std::string field;
+    while (std::getline(ss, field, ':')) fields.push_back(field);
+    if (fields.size() != 3) return false;
+
+    long long size, ways = 0, line;
+    if (!parseNumber(fields[0], 0, UINT32_MAX, size) || !parseNumber(fields[2], 0, UINT32_MAX, line)) return false;
+    if (fields[1] != "full" && !parseNumber(fields[1], 0, UINT32_MAX, ways)) return false;
+
+    config.sizeBytes = size;
+    config.associativity = ways;
+    config.lineSize = line;
+    return true;
+}
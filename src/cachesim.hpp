@@ -0,0 +1,88 @@
+#ifndef CACHESIM_HPP
+#define CACHESIM_HPP
+
+#include "observer.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct CacheConfig {
+    uint32_t sizeBytes;
+    uint32_t associativity;   // 0 means fully associative
+    uint32_t lineSize;
+
+    uint32_t lines() const { return sizeBytes / lineSize; }
+    uint32_t ways() const { return associativity ? associativity : lines(); }
+    uint32_t sets() const { return lines() / ways(); }
+};
+
+struct CacheStats {
+    uint64_t accesses = 0;
+    uint64_t hits = 0;
+
+    uint64_t misses() const { return accesses - hits; }
+    double missRatio() const { return accesses ? static_cast<double>(misses()) / accesses : 0.0; }
+};
+
+// Simulates many LRU caches over one access stream in a single pass.
+//
+// Configurations with the same line size and number of sets see the same
+// per-set LRU stack, and a cache of A ways hits exactly when the block is
+// within the top A entries of its set's stack.  So each such group keeps one
+// stack per set, bounded by its widest member, and a single lookup decides the
+// outcome for every associativity in the group.
+class MultiCacheSimulator {
+public:
+    // Returns false for a configuration that does not describe a cache.
+    bool add(const CacheConfig& config);
+    void addDefaultSweep();
+
+    void access(uint32_t address);
+
+    size_t size() const { return configs_.size(); }
+    const CacheConfig& config(size_t i) const { return configs_[i]; }
+    const CacheStats& stats(size_t i) const { return stats_[i]; }
+
+    void writeReport(std::ostream& out, const std::string& name) const;
+
+private:
+    struct Group {
+        uint32_t lineSize;
+        uint32_t sets;
+        uint32_t maxWays;
+        std::vector<size_t> members;            // indices into configs_
+        std::vector<std::vector<uint32_t>> stacks;   // per set, most recent first
+    };
+
+    std::vector<CacheConfig> configs_;
+    std::vector<CacheStats> stats_;
+    std::vector<Group> groups_;
+};
+
+// Runs separate cache sweeps over the data accesses and the instruction
+// fetches of a run.
+class CacheSweep : public PipelineObserver {
+public:
+    MultiCacheSimulator& data() { return data_; }
+    MultiCacheSimulator& instructions() { return instructions_; }
+
+    void onInstructionFetch(Processor& cpu, uint32_t pc) override { instructions_.access(pc); }
+    void onMemoryAccess(Processor& cpu, const MemoryAccess& access) override { data_.access(access.address); }
+
+    void writeReport(std::ostream& out) const {
+        data_.writeReport(out, "data");
+        out << "\n";
+        instructions_.writeReport(out, "instruction");
+    }
+
+private:
+    MultiCacheSimulator data_;
+    MultiCacheSimulator instructions_;
+};
+
+// Parses "<size>:<assoc>:<line>" where assoc 0 or "full" is fully associative.
+bool parseCacheConfig(const std::string& spec, CacheConfig& config);
+
+#endif
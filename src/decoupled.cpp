@@ -0,0 +1,93 @@
+#include "decoupled.hpp"
+#include "functional.hpp"
+#include "simulator.hpp"
+
+TraceRing::TraceRing(size_t capacity)
+    : closed_(false), cancelled_(false), pushed_(0), releasedSeen_(0), released_(0), pushedSeen_(0) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    slots_.resize(size);
+    mask_ = size - 1;
+}
+
+bool TraceRing::push(const TraceRecord& record) {
+    size_t index = pushed_.load(std::memory_order_relaxed);
+    while (index - releasedSeen_ >= slots_.size()) {
+        releasedSeen_ = released_.load(std::memory_order_acquire);
+        if (index - releasedSeen_ < slots_.size()) break;
+        if (cancelled_.load(std::memory_order_acquire)) return false;
+        std::this_thread::yield();
+    }
+    slots_[index & mask_] = record;
+    pushed_.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+const TraceRecord* TraceRing::record(size_t index) {
+    while (index >= pushedSeen_) {
+        // Closing follows the last push, so once closed a second look at
+        // pushed_ is final.
+        bool closed = closed_.load(std::memory_order_acquire);
+        pushedSeen_ = pushed_.load(std::memory_order_acquire);
+        if (index < pushedSeen_) break;
+        if (closed) return nullptr;
+        std::this_thread::yield();
+    }
+    return &slots_[index & mask_];
+}
+
+void TraceRing::release(size_t index) {
+    if (index > released_.load(std::memory_order_relaxed)) released_.store(index, std::memory_order_release);
+}
+
+bool DecoupledExecution::start(Simulator& sim, std::string& error) {
+    finish();
+    const Processor& cpu = sim.processor();
+    if (cpu.clockCycle != 0) {
+        error = "decoupled execution must start at cycle 0";
+        return false;
+    }
+
+    initialRegisters_ = cpu.regFile;
+    initialMemory_ = cpu.dataMem;
+    initialPc_ = cpu.pc;
+    functional_ = Processor();
+    functional_.instMem = cpu.instMem;
+    functional_.regFile = initialRegisters_;
+    functional_.dataMem = initialMemory_;
+    functional_.pc = initialPc_;
+
+    ring_.reset(new TraceRing(capacity_));
+    producer_ = std::thread([this]() {
+        TraceRecord record;
+        while (executeInstruction(functional_, &record) && ring_->push(record)) {}
+        ring_->close();
+    });
+    sim_ = &sim;
+    sim.replayFrom(ring_.get());
+    return true;
+}
+
+void DecoupledExecution::finish() {
+    if (!sim_) return;
+    ring_->cancel();
+    producer_.join();
+    sim_->replayFrom(nullptr);
+
+    // Execute again from the start up to where the timing model got, which
+    // costs a fraction of the timing run.
+    Processor& cpu = sim_->processor();
+    functional_.regFile = initialRegisters_;
+    functional_.dataMem = initialMemory_;
+    functional_.pc = initialPc_;
+    for (int i = 0; i < cpu.instructionsExecuted; i++) executeInstruction(functional_);
+    cpu.regFile = functional_.regFile;
+    if (cpu.memWb.valid) {
+        executeInstruction(functional_);
+        if (cpu.memWb.instruction.fusion != FUSE_NONE) executeInstruction(functional_);
+    }
+    cpu.dataMem = functional_.dataMem;
+
+    ring_.reset();
+    sim_ = nullptr;
+}
@@ -0,0 +1,91 @@
+#ifndef DECOUPLED_HPP
+#define DECOUPLED_HPP
+
+#include "processor.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Simulator;
+
+// Single-producer, single-consumer ring of TraceRecords between a functional
+// thread and a replaying timing model.  Each side keeps its own position in
+// a cache line of its own and a cached copy of the other's, so the shared
+// positions are only read when the cached one says the ring is full or
+// empty.  A full ring holds the producer back; the consumer waits for a
+// record it needs until one is pushed or the stream is closed.
+class TraceRing : public TraceSource {
+public:
+    // The capacity is rounded up to a power of two.
+    explicit TraceRing(size_t capacity);
+
+    // Producer side.  push() returns false, dropping the record, once the
+    // ring has been cancelled.
+    bool push(const TraceRecord& record);
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    // Consumer side.  Records stay where they are until released, so a
+    // squash can go back to any record after the last one released.
+    const TraceRecord* record(size_t index) override;
+    void release(size_t index) override;
+
+    // Makes a waiting or later push() fail.
+    void cancel() { cancelled_.store(true, std::memory_order_release); }
+
+private:
+    std::vector<TraceRecord> slots_;
+    size_t mask_;
+    std::atomic<bool> closed_, cancelled_;
+
+    // Records pushed so far, and the producer's copy of released_.
+    alignas(64) std::atomic<size_t> pushed_;
+    size_t releasedSeen_;
+
+    // Records released so far, and the consumer's copy of pushed_.
+    alignas(64) std::atomic<size_t> released_;
+    size_t pushedSeen_;
+};
+
+// Runs a simulation as two host threads: a functional thread executes the
+// program architecturally (functional.hpp) and streams what each instruction
+// did through a TraceRing, and the simulator's own thread replays those
+// records through the timing model.  The program's results never depend on
+// timing in this model, so the stream needs no correction except where the
+// pipeline itself squashes, and those squashes land inside the records the
+// ring still holds.
+//
+// While the timing model replays, its registers and data memory stay as
+// they were; finish() rolls them forward to what it has completed.
+class DecoupledExecution {
+public:
+    explicit DecoupledExecution(size_t capacity = 4096) : capacity_(capacity), sim_(nullptr) {}
+    ~DecoupledExecution() { finish(); }
+
+    // Starts the functional thread from `sim`'s current architectural state
+    // and makes `sim` replay its records.  `sim` must be at cycle 0.
+    bool start(Simulator& sim, std::string& error);
+
+    // Stops the functional thread and returns the simulator to executing,
+    // with its registers as the last retired instruction left them and its
+    // data memory as the last one through MEM left it.
+    void finish();
+
+    bool running() const { return sim_ != nullptr; }
+
+private:
+    size_t capacity_;
+    Simulator* sim_;
+    RegisterFile initialRegisters_;
+    DataMemory initialMemory_;
+    uint32_t initialPc_;
+    Processor functional_;
+    std::unique_ptr<TraceRing> ring_;
+    std::thread producer_;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "dependency.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+DependencyAnalyzer::DependencyAnalyzer(size_t window)
+    : window_(window ? window : 1), completions_(window_, 0), instructions_(0), criticalPath_(0),
+      attributedStalls_(0) {
+    for (int i = 0; i < 32; i++) {
+        regReady_[i] = 0;
+        regProducerPc_[i] = 0;
+        regProduced_[i] = false;
+    }
+}
+
+DependencyAnalyzer::PairStats& DependencyAnalyzer::pair(uint32_t producerPc, uint32_t consumerPc) {
+    uint64_t key = (static_cast<uint64_t>(producerPc) << 32) | consumerPc;
+    auto it = pairs_.find(key);
+    if (it == pairs_.end()) it = pairs_.emplace(key, PairStats{producerPc, consumerPc, 0, 0}).first;
+    return it->second;
+}
+
+void DependencyAnalyzer::onRetire(Processor& cpu, const MEM_WB_Register& retired) {
+    uint32_t pc = retired.pc;
+
+    // A fused pair retires as one op; schedule its halves as the program
+    // wrote them.  The first half is never a load and always writes the rd
+    // that the second reads.
+    if (retired.instruction.fusion != FUSE_NONE) {
+        Instruction first, second;
+        cpu.decodeInstruction(cpu.instMem.readInstruction(pc), first);
+        cpu.decodeInstruction(cpu.instMem.readInstruction(pc + first.length), second);
+        retire(pc, first, false, true);
+        retire(pc + first.length, second, retired.control.memRead, retired.control.regWrite);
+        return;
+    }
+
+    retire(pc, retired.instruction, retired.control.memRead, retired.control.regWrite);
+}
+
+void DependencyAnalyzer::retire(uint32_t pc, const Instruction& instruction, bool load, bool regWrite) {
+    // The slot being overwritten holds the instruction `window_` places older.
+    uint64_t& slot = completions_[instructions_ % window_];
+    uint64_t start = instructions_ >= window_ ? slot : 0;
+
+    int sources[2] = {readsRs1(instruction) ? instruction.rs1 : 0, readsRs2(instruction) ? instruction.rs2 : 0};
+    for (int i = 0; i < 2; i++) {
+        int reg = sources[i];
+        if (reg == 0 || (i == 1 && reg == sources[0]) || !regProduced_[reg]) continue;
+        start = std::max(start, regReady_[reg]);
+        pair(regProducerPc_[reg], pc).occurrences++;
+    }
+
+    uint64_t finish = start + (load ? 2 : 1);
+    slot = finish;
+    criticalPath_ = std::max(criticalPath_, finish);
+    instructions_++;
+
+    if (regWrite && instruction.rd > 0) {
+        regReady_[instruction.rd] = finish;
+        regProducerPc_[instruction.rd] = pc;
+        regProduced_[instruction.rd] = true;
+    }
+}
+
+void DependencyAnalyzer::onStall(Processor& cpu) {
+    const Instruction& consumer = cpu.ifId.instruction;
+    int rs1 = readsRs1(consumer) ? consumer.rs1 : 0;
+    int rs2 = readsRs2(consumer) ? consumer.rs2 : 0;
+
+    auto matches = [rs1, rs2](bool valid, const ControlSignals& control, int rd) {
+        return valid && control.regWrite && rd > 0 && (rd == rs1 || rd == rs2);
+    };
+
+    uint32_t producerPc;
+    if (matches(cpu.idEx.valid, cpu.idEx.control, cpu.idEx.instruction.rd)) producerPc = cpu.idEx.pc;
+    else if (matches(cpu.exMem.valid, cpu.exMem.control, cpu.exMem.instruction.rd)) producerPc = cpu.exMem.pc;
+    else if (matches(cpu.memWb.valid, cpu.memWb.control, cpu.memWb.instruction.rd)) producerPc = cpu.memWb.pc;
+    else return;
+
+    pair(producerPc, cpu.ifId.pc).stallCycles++;
+    attributedStalls_++;
+}
+
+std::vector<DependencyAnalyzer::PairStats> DependencyAnalyzer::topPairs(size_t count) const {
+    std::vector<PairStats> result;
+    for (const auto& entry : pairs_) {
+        if (entry.second.stallCycles) result.push_back(entry.second);
+    }
+    std::sort(result.begin(), result.end(), [](const PairStats& a, const PairStats& b) {
+        if (a.stallCycles != b.stallCycles) return a.stallCycles > b.stallCycles;
+        if (a.producerPc != b.producerPc) return a.producerPc < b.producerPc;
+        return a.consumerPc < b.consumerPc;
+    });
+    if (result.size() > count) result.resize(count);
+    return result;
+}
+
+void DependencyAnalyzer::writeReport(std::ostream& out, size_t topCount) const {
+    out << "instructions retired: " << instructions_ << "\n";
+    out << "critical path (window " << window_ << "): " << criticalPath_ << " cycles\n";
+    out << "ideal dataflow IPC: " << dataflowIpc() << "\n";
+    out << "stall cycles attributed to dependencies: " << attributedStalls_ << "\n";
+    out << "\nproducer_pc,consumer_pc,occurrences,stall_cycles\n";
+    for (const PairStats& stats : topPairs(topCount)) {
+        out << "0x" << std::hex << std::setw(8) << std::setfill('0') << stats.producerPc
+            << ",0x" << std::setw(8) << stats.consumerPc << std::dec << std::setfill(' ')
+            << "," << stats.occurrences << "," << stats.stallCycles << "\n";
+    }
+}
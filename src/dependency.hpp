@@ -0,0 +1,69 @@
+#ifndef DEPENDENCY_HPP
+#define DEPENDENCY_HPP
+
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Streaming analysis of the register dependencies between retired
+// instructions.
+//
+// Each retired instruction is scheduled on an ideal dataflow machine: it
+// starts once its source registers are produced and once the instruction
+// `window` places older has completed, which bounds the lookahead the same way
+// a finite instruction window would.  Loads take two cycles, everything else
+// one.  The halves of a fused pair are scheduled as two instructions.  Only
+// the per-register ready times and a ring of `window` completion times are
+// kept, so the cost per instruction is constant.
+//
+// Stall cycles are attributed to the producer/consumer pair that caused them:
+// on every stall, the youngest older instruction writing a source register of
+// the instruction held in IF/ID is the producer.  That follows the
+// HazardDetectionUnit decision of the pipeline that is actually running.
+class DependencyAnalyzer : public PipelineObserver {
+public:
+    explicit DependencyAnalyzer(size_t window = 64);
+
+    void onRetire(Processor& cpu, const MEM_WB_Register& retired) override;
+    void onStall(Processor& cpu) override;
+
+    uint64_t instructions() const { return instructions_; }
+    uint64_t criticalPathLength() const { return criticalPath_; }
+    double dataflowIpc() const {
+        return criticalPath_ ? static_cast<double>(instructions_) / criticalPath_ : 0.0;
+    }
+    uint64_t attributedStalls() const { return attributedStalls_; }
+
+    struct PairStats {
+        uint32_t producerPc, consumerPc;
+        uint64_t occurrences;   // dynamic dependencies between the two PCs
+        uint64_t stallCycles;
+    };
+
+    // Pairs sorted by stall cycles, most expensive first.
+    std::vector<PairStats> topPairs(size_t count) const;
+
+    void writeReport(std::ostream& out, size_t topCount = 10) const;
+
+private:
+    PairStats& pair(uint32_t producerPc, uint32_t consumerPc);
+    void retire(uint32_t pc, const Instruction& instruction, bool load, bool regWrite);
+
+    size_t window_;
+    std::vector<uint64_t> completions_;   // ring indexed by instruction number
+    uint64_t instructions_;
+    uint64_t criticalPath_;
+    uint64_t attributedStalls_;
+
+    uint64_t regReady_[32];
+    uint32_t regProducerPc_[32];
+    bool regProduced_[32];
+
+    std::unordered_map<uint64_t, PairStats> pairs_;
+};
+
+#endif
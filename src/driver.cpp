@@ -0,0 +1,369 @@
+#include "driver.hpp"
+#include "cachesim.hpp"
+#include "decoupled.hpp"
+#include "dependency.hpp"
+#include "energy.hpp"
+#include "exectrace.hpp"
+#include "locality.hpp"
+#include "memtrace.hpp"
+#include "options.hpp"
+#include "phases.hpp"
+#include "resultcache.hpp"
+#include "simulator.hpp"
+#include "topdown.hpp"
+#include "watchpoint.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// Runs the program loaded in `configured` under `config` until it has retired
+// `instructions` instructions, so variants can be compared on the same work.
+static SimulatorStats runToInstructionCount(const Simulator& configured, SimulatorConfig config,
+                                            uint64_t instructions, uint64_t maxCycles) {
+    config.traceEnabled = false;
+    Simulator sim(config);
+    sim.processor().instMem = configured.processor().instMem;
+    sim.reset();
+    while (sim.stats().instructionsRetired < instructions && !sim.halted() && sim.stats().cycles < maxCycles) {
+        sim.step();
+    }
+    return sim.stats();
+}
+
+// Runs the program under each load-to-use variant until it has retired as
+// many instructions as the configured machine does in `cycles` cycles, and
+// prints what each variant costs against the original one-cycle load.
+static void runLoadStudy(const Simulator& configured, uint64_t cycles, std::ostream& out) {
+    SimulatorConfig config = configured.config();
+    uint64_t target = runToInstructionCount(configured, config, UINT64_MAX, cycles).instructionsRetired;
+
+    out << "Load-use study over " << target << " instructions:" << std::endl;
+    out << "  latency  early-address  cycles  load-stalls  saved" << std::endl;
+
+    uint64_t baseline = 0;
+    for (int early = 0; early < 2; early++) {
+        for (int latency = 1; latency <= 3; latency++) {
+            config.core.loadUseLatency = latency;
+            config.core.earlyLoadAddress = early;
+            SimulatorStats stats = runToInstructionCount(configured, config, target, 4 * cycles);
+
+            if (!early && latency == 1) baseline = stats.cycles;
+            out << std::right << std::setw(9) << latency << std::setw(15) << (early ? "yes" : "no") << std::setw(8)
+                << stats.cycles << std::setw(13) << stats.loadUseStalls << std::setw(7)
+                << static_cast<int64_t>(baseline - stats.cycles) << std::endl;
+        }
+    }
+}
+
+int runDriver(int argc, char *argv[], bool isForwarding) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <filename> <cyclecount> [--config <file>] "
+                  << "[--forwarding on|off] [--data-memory <bytes>] [--output <file>] [--csv-trace <file>] "
+                  << "[--mem-log <file>] [--mem-log-capacity <n>] [--watch <addr>[:<len>[:r|w|a[:stop|log]]]] "
+                  << "[--locality <file>] [--locality-block <bytes>] "
+                  << "[--cache-sweep <file>] [--cache <size>:<assoc|full>:<line>] "
+                  << "[--deps <file>] [--deps-window <n>] [--topdown <file>] [--topdown-region <bytes>] "
+                  << "[--bbv <file>] [--bbv-interval <n>] "
+                  << "[--fetch-queue <n>] [--icache <size>:<line>:<latency>] "
+                  << "[--load-latency <n>] [--early-load-address] [--load-study] "
+                  << "[--fuse all|<idiom>[,<idiom>...]] [--load-predictor none|last-value|stride] "
+                  << "[--address-predictor] [--predictor-entries <n>] [--loop-buffer <n>] "
+                  << "[--energy <file>] [--energy-costs <file>] [--result-cache <dir>] "
+                  << "[--record <file>] [--replay <file>] [--decoupled]" << std::endl;
+        return 1;
+    }
+
+    DriverOptions options(isForwarding);
+    std::string error;
+    if (!parseOptions(argc, argv, options, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    const int cyclecount = options.cycles;
+    const SimulatorConfig& config = options.simulator;
+    const CoreConfig& core = config.core;
+    Simulator sim(config);
+    if (options.replayFile.empty()) {
+        if (!sim.loadProgram(options.program)) return 1;
+    } else {
+        std::ifstream traceFile(options.replayFile, std::ios::binary);
+        std::shared_ptr<ExecutionTrace> trace(new ExecutionTrace());
+        if (!traceFile) error = "cannot open execution trace " + options.replayFile;
+        else if (!readExecutionTrace(traceFile, *trace, error)) error = "in " + options.replayFile + ": " + error;
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        sim.loadExecutionTrace(trace);
+    }
+
+    ExecutionTrace recorded;
+    ExecutionRecorder recorder(recorded);
+    if (!options.recordFile.empty()) sim.addObserver(&recorder);
+
+    MemoryAccessLog memLog(options.memLogCapacity);
+    if (!options.memLogFile.empty()) {
+        if (options.logWatchpoints) options.watchpoints.setLog(&memLog);
+        else sim.addObserver(&memLog);
+    }
+    if (!options.watchpoints.empty()) sim.addObserver(&options.watchpoints);
+
+    LocalityAnalyzer locality(options.localityBlock);
+    if (!options.localityFile.empty()) sim.addObserver(&locality);
+
+    if (!options.cacheSweepFile.empty()) {
+        if (options.cacheSweep.data().size() == 0) {
+            options.cacheSweep.data().addDefaultSweep();
+            options.cacheSweep.instructions().addDefaultSweep();
+        }
+        sim.addObserver(&options.cacheSweep);
+    }
+
+    DependencyAnalyzer dependencies(options.depsWindow);
+    if (!options.depsFile.empty()) sim.addObserver(&dependencies);
+
+    TopDownAccounting topDown(options.topDownRegion);
+    if (!options.topDownFile.empty()) sim.addObserver(&topDown);
+
+    BasicBlockProfile basicBlocks(options.bbvInterval);
+    if (!options.bbvFile.empty()) sim.addObserver(&basicBlocks);
+
+    EnergyModel energy(options.energyCosts);
+    if (!options.energyFile.empty()) sim.addObserver(&energy);
+
+    std::cout << "Running pipeline with " << (config.forwarding ? "forwarding enabled" : "forwarding disabled")
+              << std::endl;
+    std::string outputName = options.outputPath();
+
+    // A run is only cached when no observer is attached, no CSV trace is
+    // wanted and no execution trace is recorded or replayed, since those need
+    // the simulation itself.  The entry keeps the
+    // output file, the printed trace and the summary lines, in that order.
+    ResultCache resultCache(options.resultCacheDir);
+    bool cacheable = !options.resultCacheDir.empty() && options.csvTraceFile.empty() && options.memLogFile.empty() &&
+                     options.watchpoints.empty() && options.localityFile.empty() && options.cacheSweepFile.empty() &&
+                     options.depsFile.empty() && options.topDownFile.empty() && options.bbvFile.empty() &&
+                     options.energyFile.empty() &&
+                     options.recordFile.empty() && options.replayFile.empty();
+    uint64_t resultKey = 0;
+    if (cacheable) {
+        std::string run = "cycles=" + std::to_string(cyclecount) + (options.loadStudy ? " load-study" : "");
+        resultKey = ResultCache::key(programHash(sim.processor().instMem), config, run);
+        CachedResult cached;
+        if (resultCache.lookup(resultKey, cached) && cached.traceCount() == 3) {
+            std::ofstream outputFile(outputName);
+            if (!outputFile) std::cerr << "Error opening trace file: " << outputName << std::endl;
+            else outputFile << cached.trace(0);
+            std::cout << cached.trace(1) << cached.trace(2);
+            return 0;
+        }
+    }
+
+    // Decoupled runs give the same results, so they share cache entries.
+    DecoupledExecution decoupled;
+    if (options.decoupled && !decoupled.start(sim, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    sim.step(cyclecount);
+    if (sim.replayDiverged()) {
+        std::cout << "Replay diverged in cycle " << sim.stats().cycles << ": pc 0x" << std::hex
+                  << sim.processor().ifId.pc << std::dec << " is not in the execution trace" << std::endl;
+    }
+    decoupled.finish();
+
+    if (options.watchpoints.hitPending()) {
+        const MemoryAccess& access = options.watchpoints.lastHit().access;
+        std::cout << "Watchpoint hit in cycle " << access.cycle << ": pc 0x" << std::hex << access.pc
+                  << (access.isWrite ? " wrote 0x" : " read 0x") << access.value
+                  << " at 0x" << access.address << std::dec << " (" << static_cast<int>(access.size)
+                  << " bytes)" << std::endl;
+    }
+
+    if (!options.csvTraceFile.empty()) {
+        std::ofstream traceFile(options.csvTraceFile);
+        if (!traceFile) std::cerr << "Error opening trace file: " << options.csvTraceFile << std::endl;
+        else sim.writePipelineTraceCSV(traceFile);
+    }
+
+    std::ostringstream output;
+    sim.writePipelineTraceTXT(output);
+    std::ofstream outputFile(outputName);
+    if (!outputFile) std::cerr << "Error opening trace file: " << outputName << std::endl;
+    else outputFile << output.str();
+    outputFile.close();
+
+    std::ostringstream trace;
+    sim.printPipelineTrace(trace);
+    std::cout << trace.str();
+
+    SimulatorStats stats = sim.stats();
+    std::ostringstream summary;
+    if (core.fetchQueueDepth > 0 || core.icacheSize > 0) {
+        summary << "Fetch starvation: " << stats.fetchStarvedCycles << " cycles" << std::endl;
+        if (core.icacheSize > 0) {
+            summary << "Instruction cache: " << stats.icacheAccesses << " accesses, " << stats.icacheMisses
+                    << " misses" << std::endl;
+        }
+        if (core.fetchQueueDepth > 0) {
+            const std::vector<uint64_t>& occupancy = sim.processor().fetchQueueOccupancy;
+            summary << "Fetch queue occupancy (entries: cycles):";
+            for (size_t n = 0; n < occupancy.size(); n++) summary << " " << n << ": " << occupancy[n];
+            summary << std::endl;
+        }
+    }
+    if (core.loadUseLatency != 1 || core.earlyLoadAddress) {
+        summary << "Load-use stalls: " << stats.loadUseStalls << " of " << stats.stallCycles
+                << " stall cycles" << std::endl;
+    }
+    if (options.loadStudy) runLoadStudy(sim, cyclecount, summary);
+    if (core.fusionIdioms) {
+        // Cycles the same instructions take without fusion.
+        SimulatorConfig unfused = config;
+        unfused.core.fusionIdioms = 0;
+        SimulatorStats fused = runToInstructionCount(sim, config, stats.instructionsRetired, cyclecount);
+        SimulatorStats reference = runToInstructionCount(sim, unfused, stats.instructionsRetired, 4 * cyclecount);
+
+        summary << "Macro-op fusion: " << stats.fusedPairs << " pairs (";
+        for (int kind = FUSE_NONE + 1; kind < FUSION_KIND_COUNT; kind++) {
+            summary << (kind > FUSE_NONE + 1 ? ", " : "") << fusionKindNames[kind] << " "
+                    << sim.processor().fusedPairs[kind];
+        }
+        summary << "), " << 100.0 * stats.fusionRate() << "% of retired instructions fused, "
+                << static_cast<int64_t>(reference.cycles - fused.cycles) << " cycles saved over "
+                << stats.instructionsRetired << " instructions" << std::endl;
+    }
+    if (core.loadValuePrediction != LOAD_PREDICT_NONE || core.loadAddressPrediction) {
+        // Cycles the same instructions take without load speculation.
+        SimulatorConfig unpredicted = config;
+        unpredicted.core.loadValuePrediction = LOAD_PREDICT_NONE;
+        unpredicted.core.loadAddressPrediction = false;
+        SimulatorStats predicted = runToInstructionCount(sim, config, stats.instructionsRetired, cyclecount);
+        SimulatorStats reference = runToInstructionCount(sim, unpredicted, stats.instructionsRetired, 4 * cyclecount);
+
+        const Processor& cpu = sim.processor();
+        summary << "Load prediction: " << stats.loadPredictions << " of " << stats.loadsExecuted
+                << " loads predicted (" << cpu.loadValuePredictions << " by value, " << cpu.loadAddressPredictions
+                << " by address), " << 100.0 * stats.loadPredictionCoverage() << "% coverage, "
+                << 100.0 * stats.loadPredictionAccuracy() << "% accuracy, " << stats.loadMispredicts
+                << " mispredicts, " << static_cast<int64_t>(reference.cycles - predicted.cycles)
+                << " cycles saved over " << stats.instructionsRetired << " instructions" << std::endl;
+    }
+    if (core.loopBufferSize > 0) {
+        // Cycles and fetch traffic of the same instructions without the loop
+        // buffer.
+        SimulatorConfig unbuffered = config;
+        unbuffered.core.loopBufferSize = 0;
+        SimulatorStats buffered = runToInstructionCount(sim, config, stats.instructionsRetired, cyclecount);
+        SimulatorStats reference = runToInstructionCount(sim, unbuffered, stats.instructionsRetired, 4 * cyclecount);
+
+        summary << "Loop buffer: " << stats.loopBufferReplays << " instructions replayed ("
+                << 100.0 * stats.loopBufferCoverage() << "% of those issued), " << stats.loopFlushesAvoided
+                << " loop-closing flushes avoided, " << buffered.fetchWords << " instruction words fetched vs "
+                << reference.fetchWords << " and " << buffered.instructionsFetched << " decodes vs "
+                << reference.instructionsFetched << " without it, "
+                << static_cast<int64_t>(reference.cycles - buffered.cycles) << " cycles saved over "
+                << stats.instructionsRetired << " instructions" << std::endl;
+    }
+    if (!options.energyFile.empty()) {
+        summary << "Energy: " << energy.totalEnergy(stats.cycles) << " pJ, "
+                << (stats.instructionsRetired ? energy.totalEnergy(stats.cycles) / stats.instructionsRetired : 0.0)
+                << " pJ per instruction, EDP " << energy.energyDelayProduct(stats.cycles) << " pJ*cycles at CPI "
+                << stats.cpi() << std::endl;
+    }
+    if (stats.compressedFetched) {
+        summary << "Instruction fetch: " << stats.fetchWords << " words for " << stats.instructionsFetched
+                << " instructions (" << stats.compressedFetched << " compressed), "
+                << 100.0 * stats.fetchBandwidthSaved()
+                << "% fetch bandwidth saved" << std::endl;
+    }
+
+    std::cout << summary.str();
+    if (cacheable && !resultCache.store(resultKey, stats, {output.str(), trace.str(), summary.str()})) {
+        std::cerr << "Warning: could not write to result cache " << options.resultCacheDir << std::endl;
+    }
+
+    if (!options.recordFile.empty()) {
+        recorder.finish(sim.processor());
+        std::ofstream traceFile(options.recordFile, std::ios::binary);
+        if (!traceFile) {
+            std::cerr << "Error opening execution trace file: " << options.recordFile << std::endl;
+            return 1;
+        }
+        writeExecutionTrace(traceFile, recorded);
+    }
+
+    if (!options.memLogFile.empty()) {
+        std::ofstream logFile(options.memLogFile, std::ios::binary);
+        if (!logFile) {
+            std::cerr << "Error opening memory log file: " << options.memLogFile << std::endl;
+            return 1;
+        }
+        memLog.write(logFile);
+    }
+
+    if (!options.localityFile.empty()) {
+        std::ofstream reportFile(options.localityFile);
+        if (!reportFile) {
+            std::cerr << "Error opening locality report file: " << options.localityFile << std::endl;
+            return 1;
+        }
+        locality.writeReport(reportFile);
+    }
+
+    if (!options.cacheSweepFile.empty()) {
+        std::ofstream reportFile(options.cacheSweepFile);
+        if (!reportFile) {
+            std::cerr << "Error opening cache sweep file: " << options.cacheSweepFile << std::endl;
+            return 1;
+        }
+        options.cacheSweep.writeReport(reportFile);
+    }
+
+    if (!options.depsFile.empty()) {
+        std::ofstream reportFile(options.depsFile);
+        if (!reportFile) {
+            std::cerr << "Error opening dependency report file: " << options.depsFile << std::endl;
+            return 1;
+        }
+        dependencies.writeReport(reportFile);
+    }
+
+    if (!options.topDownFile.empty()) {
+        std::ofstream reportFile(options.topDownFile);
+        if (!reportFile) {
+            std::cerr << "Error opening top-down report file: " << options.topDownFile << std::endl;
+            return 1;
+        }
+        topDown.writeReport(reportFile);
+    }
+
+    if (!options.bbvFile.empty()) {
+        basicBlocks.finish();
+        std::ofstream reportFile(options.bbvFile);
+        if (!reportFile) {
+            std::cerr << "Error opening basic-block vector file: " << options.bbvFile << std::endl;
+            return 1;
+        }
+        basicBlocks.write(reportFile);
+    }
+
+    if (!options.energyFile.empty()) {
+        std::ofstream reportFile(options.energyFile);
+        if (!reportFile) {
+            std::cerr << "Error opening energy report file: " << options.energyFile << std::endl;
+            return 1;
+        }
+        energy.writeReport(reportFile, stats.cycles, stats.instructionsRetired);
+    }
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+// Command-line front end shared by the forward and noforward executables:
+//
+//     <binary> <filename> <cyclecount> [options]
+//
+// `isForwarding` is only the default; options.hpp lists how options and
+// config files are read.  Options include:
+//     --config <file>              read options from a file
+//     --forwarding on|off          override the binary's forwarding mode
+//     --data-memory <bytes>        data memory size (default 1024)
+//     --output <file>              stage table path (default derived from
+//                                  the program name and forwarding mode)
+//     --csv-trace <file>           also write the stage table as CSV
+//     --mem-log <file>             write the data memory access log (binary)
+//     --mem-log-capacity <n>       keep the most recent n accesses (default 1M)
+//     --watch <addr>[:<len>[:r|w|a[:stop|log]]]
+//                                  watch a data address range; a stop
+//                                  watchpoint ends the run, a log watchpoint
+//                                  records its hits in the memory access log
+//                                  (which then holds only those hits)
+int runDriver(int argc, char *argv[], bool isForwarding);
+
+#endif
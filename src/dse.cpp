@@ -0,0 +1,327 @@
+#include "dse.hpp"
+#include "decoupled.hpp"
+#include "exectrace.hpp"
+#include "loader.hpp"
+#include "steadystate.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <set>
+#include <sstream>
+
+uint64_t Workload::hash() const {
+    uint64_t hash = programHash(program);
+    for (const auto& reg : registers) {
+        hash = hashBytes(hash, &reg.first, sizeof(reg.first));
+        hash = hashBytes(hash, &reg.second, sizeof(reg.second));
+    }
+    return data.empty() ? hash : hashBytes(hash, data.data(), data.size());
+}
+
+void Workload::prepare(Simulator& sim) const {
+    Processor& cpu = sim.processor();
+    cpu.instMem = program;
+    sim.reset();
+    for (const auto& reg : registers) sim.writeRegister(reg.first, reg.second);
+    for (size_t i = 0; i < data.size(); i++) sim.writeMemory(i, data[i], 1);
+}
+
+bool parseWorkload(const std::string& spec, Workload& workload, std::string& error) {
+    std::vector<std::string> fields;
+    std::stringstream ss(spec);
+    std::string field;
+    while (std::getline(ss, field, ':')) fields.push_back(field);
+    if (fields.empty() || fields[0].empty()) {
+        error = "missing program in workload " + spec;
+        return false;
+    }
+
+    workload = Workload();
+    workload.name = fields[0];
+    std::ifstream programFile(fields[0]);
+    if (!programFile) {
+        error = "cannot open program " + fields[0];
+        return false;
+    }
+    loadProgram(programFile, workload.program);
+
+    for (size_t i = 1; i < fields.size(); i++) {
+        const std::string& setting = fields[i];
+        if (!setting.empty() && setting[0] == '@') {
+            std::ifstream dataFile(setting.substr(1), std::ios::binary);
+            if (!dataFile) {
+                error = "cannot open data file " + setting.substr(1);
+                return false;
+            }
+            workload.data.assign(std::istreambuf_iterator<char>(dataFile), std::istreambuf_iterator<char>());
+            continue;
+        }
+
+        size_t equals = setting.find('=');
+        int reg = setting.size() > 1 && setting[0] == 'x' ? std::atoi(setting.c_str() + 1) : -1;
+        if (equals == std::string::npos || reg < 1 || reg > 31) {
+            error = "bad workload setting " + setting;
+            return false;
+        }
+        int32_t value = std::strtol(setting.c_str() + equals + 1, nullptr, 0);
+        workload.registers.push_back(std::make_pair(reg, value));
+    }
+    return true;
+}
+
+DesignSpace::DesignSpace()
+    : forwarding{0, 1}, fetchQueueDepth{0, 4}, icacheSize{256, 1024}, loadUseLatency{1, 2, 3},
+      earlyLoadAddress{0, 1}, loadValuePrediction{LOAD_PREDICT_NONE, LOAD_PREDICT_LAST_VALUE, LOAD_PREDICT_STRIDE},
+      loopBufferSize{0, 8}, fusionIdioms{0, 1} {}
+
+// Named values a parameter also accepts besides plain integers.
+static bool parseValue(const std::string& name, const std::string& text, int& value) {
+    if (text == "off" || text == "none") value = 0;
+    else if (text == "on" || (name == "fusion" && text == "all")) value = 1;
+    else if (name == "value-predictor" && text == "last-value") value = LOAD_PREDICT_LAST_VALUE;
+    else if (name == "value-predictor" && text == "stride") value = LOAD_PREDICT_STRIDE;
+    else {
+        char* end;
+        value = std::strtol(text.c_str(), &end, 0);
+        return !text.empty() && *end == '\0' && value >= 0;
+    }
+    return true;
+}
+
+bool DesignSpace::parse(const std::string& spec, std::string& error) {
+    size_t equals = spec.find('=');
+    std::string name = spec.substr(0, equals);
+    std::vector<int>* values;
+    if (name == "forwarding") values = &forwarding;
+    else if (name == "fetch-queue") values = &fetchQueueDepth;
+    else if (name == "icache") values = &icacheSize;
+    else if (name == "load-latency") values = &loadUseLatency;
+    else if (name == "early-address") values = &earlyLoadAddress;
+    else if (name == "value-predictor") values = &loadValuePrediction;
+    else if (name == "loop-buffer") values = &loopBufferSize;
+    else if (name == "fusion") values = &fusionIdioms;
+    else {
+        error = "unknown design parameter " + name;
+        return false;
+    }
+    if (equals == std::string::npos) {
+        error = "no values given for " + name;
+        return false;
+    }
+
+    std::vector<int> parsed;
+    std::stringstream ss(spec.substr(equals + 1));
+    std::string text;
+    while (std::getline(ss, text, ',')) {
+        int value;
+        if (!parseValue(name, text, value) || (name == "load-latency" && value < 1) ||
+            (name == "value-predictor" && value > LOAD_PREDICT_STRIDE)) {
+            error = "bad value " + text + " for " + name;
+            return false;
+        }
+        parsed.push_back(value);
+    }
+    if (parsed.empty()) {
+        error = "no values given for " + name;
+        return false;
+    }
+    *values = parsed;
+    return true;
+}
+
+uint64_t DesignSpace::size() const {
+    return forwarding.size() * fetchQueueDepth.size() * icacheSize.size() * loadUseLatency.size() *
+           earlyLoadAddress.size() * loadValuePrediction.size() * loopBufferSize.size() * fusionIdioms.size();
+}
+
+// Takes the next mixed-radix digit of `index` as a choice from `values`.
+static int pick(const std::vector<int>& values, uint64_t& index) {
+    int value = values[index % values.size()];
+    index /= values.size();
+    return value;
+}
+
+SimulatorConfig DesignSpace::point(uint64_t index, const SimulatorConfig& base) const {
+    SimulatorConfig config = base;
+    CoreConfig& core = config.core;
+    config.forwarding = pick(forwarding, index) != 0;
+    core.fetchQueueDepth = pick(fetchQueueDepth, index);
+    core.icacheSize = pick(icacheSize, index);
+    core.loadUseLatency = pick(loadUseLatency, index);
+    core.earlyLoadAddress = pick(earlyLoadAddress, index) != 0;
+    core.loadValuePrediction = static_cast<LoadValuePrediction>(pick(loadValuePrediction, index));
+    core.loopBufferSize = pick(loopBufferSize, index);
+    core.fusionIdioms = pick(fusionIdioms, index) ? ((1u << FUSION_KIND_COUNT) - 1) & ~1u : 0;
+    return config;
+}
+
+std::vector<uint64_t> DesignSpace::sample(uint64_t count, uint64_t seed) const {
+    uint64_t total = size();
+    std::vector<uint64_t> indices;
+    if (count >= total) {
+        for (uint64_t i = 0; i < total; i++) indices.push_back(i);
+        return indices;
+    }
+
+    // Floyd's algorithm: `count` distinct draws without a shuffle of the
+    // whole space.
+    std::mt19937_64 random(seed);
+    std::set<uint64_t> chosen;
+    for (uint64_t j = total - count; j < total; j++) {
+        uint64_t draw = std::uniform_int_distribution<uint64_t>(0, j)(random);
+        chosen.insert(chosen.count(draw) ? j : draw);
+    }
+    indices.assign(chosen.begin(), chosen.end());
+    return indices;
+}
+
+double hardwareCost(const SimulatorConfig& config) {
+    const CoreConfig& core = config.core;
+    double cost = 120.0;
+    if (config.forwarding) cost += 6.0;
+    cost += 2.0 * core.fetchQueueDepth;
+    if (core.icacheSize) cost += core.icacheSize / 4.0 + 0.5 * core.icacheSize / core.icacheLineSize;
+    cost += 16.0 / core.loadUseLatency;
+    if (core.earlyLoadAddress) cost += 4.0;
+    if (core.loadValuePrediction != LOAD_PREDICT_NONE) cost += 2.0 * core.loadPredictorEntries;
+    if (core.loadAddressPrediction) cost += 2.0 * core.loadPredictorEntries;
+    cost += 2.0 * core.loopBufferSize;
+    for (int kind = FUSE_NONE + 1; kind < FUSION_KIND_COUNT; kind++) {
+        if (core.fusionIdioms & (1u << kind)) cost += 3.0;
+    }
+    return cost;
+}
+
+void markParetoFront(std::vector<DesignResult>& results) {
+    for (DesignResult& result : results) {
+        result.pareto = true;
+        for (const DesignResult& other : results) {
+            bool noWorse = other.cpi() <= result.cpi() && other.cost <= result.cost;
+            bool better = other.cpi() < result.cpi() || other.cost < result.cost;
+            if (noWorse && better) {
+                result.pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+void writeDesignResults(std::ostream& out, const std::vector<DesignResult>& results) {
+    out << "index,forwarding,fetch_queue,icache,load_latency,early_address,value_predictor,loop_buffer,fusion,"
+        << "cost,cycles,instructions,cpi,pareto\n";
+    for (const DesignResult& result : results) {
+        const CoreConfig& core = result.config.core;
+        out << result.index << "," << result.config.forwarding << "," << core.fetchQueueDepth << ","
+            << core.icacheSize << "," << core.loadUseLatency << "," << core.earlyLoadAddress << ","
+            << core.loadValuePrediction << "," << core.loopBufferSize << "," << (core.fusionIdioms != 0) << ","
+            << result.cost << "," << result.cycles << "," << result.instructions << "," << std::fixed
+            << std::setprecision(4) << result.cpi() << std::defaultfloat << std::setprecision(6) << ","
+            << result.pareto << "\n";
+    }
+}
+
+// Records each workload far enough for any point: one retires at most two
+// instructions a cycle, and ID may hold a few more than have retired when the
+// budget is reached.
+void DesignSpaceExplorer::recordWorkloads(unsigned threads) {
+    uint64_t instructions = std::min(instructionBudget_, 2 * maxCycles_) + 8;
+    traces_.assign(workloads_.size(), nullptr);
+
+    WorkStealingPool pool(threads);
+    pool.run(workloads_.size(), [&](size_t w) {
+        SimulatorConfig config;
+        config.traceEnabled = false;
+        Simulator sim(config);
+        workloads_[w].prepare(sim);
+        std::shared_ptr<ExecutionTrace> trace(new ExecutionTrace());
+        recordExecution(sim, instructions, UINT64_MAX, *trace);
+        traces_[w] = trace;
+    });
+}
+
+SimulatorStats DesignSpaceExplorer::simulate(size_t w, const SimulatorConfig& config) {
+    const Workload& workload = workloads_[w];
+    std::pair<uint64_t, uint64_t> key(workload.hash(), configHash(config));
+    {
+        std::lock_guard<std::mutex> guard(cacheLock_);
+        auto it = cache_.find(key);
+        if (it != cache_.end()) {
+            cacheHits_++;
+            return it->second;
+        }
+    }
+
+    uint64_t resultKey = 0;
+    if (resultCache_) {
+        std::string run = "instructions=" + std::to_string(instructionBudget_) +
+                          " max-cycles=" + std::to_string(maxCycles_) + (replay_ ? " replay" : "");
+        resultKey = ResultCache::key(key.first, config, run);
+        CachedResult cached;
+        if (resultCache_->lookup(resultKey, cached)) {
+            std::lock_guard<std::mutex> guard(cacheLock_);
+            cache_[key] = cached.stats();
+            cacheHits_++;
+            return cached.stats();
+        }
+    }
+
+    SimulatorConfig untraced = config;
+    untraced.traceEnabled = false;
+    Simulator sim(untraced);
+    DecoupledExecution decoupled;
+    std::string error;
+    if (replay_) sim.loadExecutionTrace(traces_[w]);
+    else workload.prepare(sim);
+    if (decoupled_ && !replay_) decoupled.start(sim, error);
+
+    const Processor& cpu = sim.processor();
+    if (extrapolate_ && !replay_ && !decoupled_) {
+        runWithExtrapolation(sim, instructionBudget_, maxCycles_);
+    } else {
+        while (static_cast<uint64_t>(cpu.instructionsExecuted) < instructionBudget_ && !sim.halted() &&
+               static_cast<uint64_t>(cpu.clockCycle) < maxCycles_) {
+            sim.step();
+        }
+    }
+    SimulatorStats stats = sim.stats();
+    if (resultCache_) resultCache_->store(resultKey, stats, std::vector<std::string>());
+
+    std::lock_guard<std::mutex> guard(cacheLock_);
+    cache_[key] = stats;
+    simulations_++;
+    return stats;
+}
+
+std::vector<DesignResult> DesignSpaceExplorer::evaluate(
+    const std::vector<std::pair<uint64_t, SimulatorConfig> >& points, unsigned threads) {
+    size_t runs = points.size() * workloads_.size();
+    std::vector<SimulatorStats> stats(runs);
+    if (replay_ && traces_.empty()) recordWorkloads(threads);
+
+    WorkStealingPool pool(threads);
+    pool.run(runs, [&](size_t run) {
+        stats[run] = simulate(run % workloads_.size(), points[run / workloads_.size()].second);
+    });
+
+    std::vector<DesignResult> results;
+    for (size_t p = 0; p < points.size(); p++) {
+        DesignResult result;
+        result.index = points[p].first;
+        result.config = points[p].second;
+        result.cycles = 0;
+        result.instructions = 0;
+        for (size_t w = 0; w < workloads_.size(); w++) {
+            result.cycles += stats[p * workloads_.size() + w].cycles;
+            result.instructions += stats[p * workloads_.size() + w].instructionsRetired;
+        }
+        result.cost = hardwareCost(result.config);
+        result.pareto = false;
+        results.push_back(result);
+    }
+    markParetoFront(results);
+    return results;
+}
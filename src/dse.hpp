@@ -0,0 +1,123 @@
+#ifndef DSE_HPP
+#define DSE_HPP
+
+#include "resultcache.hpp"
+#include "simulator.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A program together with the registers and data memory it starts from.
+struct Workload {
+    std::string name;
+    InstructionMemory program;
+    std::vector<std::pair<int, int32_t> > registers;
+    std::vector<uint8_t> data;   // loaded at address 0
+
+    // Covers the program and its initial state.
+    uint64_t hash() const;
+
+    void prepare(Simulator& sim) const;
+};
+
+// Parses "<program>[:x<n>=<value>...][:@<data file>]".  The data file holds
+// raw bytes.
+bool parseWorkload(const std::string& spec, Workload& workload, std::string& error);
+
+// The values each design parameter may take.  A design point picks one value
+// per parameter, and points are numbered in mixed radix so the space can be
+// enumerated or sampled by index.
+struct DesignSpace {
+    std::vector<int> forwarding;
+    std::vector<int> fetchQueueDepth;
+    std::vector<int> icacheSize;
+    std::vector<int> loadUseLatency;
+    std::vector<int> earlyLoadAddress;
+    std::vector<int> loadValuePrediction;
+    std::vector<int> loopBufferSize;
+    std::vector<int> fusionIdioms;
+
+    DesignSpace();
+
+    // Replaces one parameter's values from "<name>=<v>[,<v>...]".
+    bool parse(const std::string& spec, std::string& error);
+
+    uint64_t size() const;
+    SimulatorConfig point(uint64_t index, const SimulatorConfig& base) const;
+
+    // Distinct indices in increasing order: all of them when `count` covers
+    // the space, otherwise a uniform sample.
+    std::vector<uint64_t> sample(uint64_t count, uint64_t seed) const;
+};
+
+// Relative area of a configuration, in units of roughly one 32-bit
+// register: the base pipeline, plus bypass paths, queue and buffer entries,
+// cache bytes, predictor tables, fusion decoders, and a faster data memory.
+double hardwareCost(const SimulatorConfig& config);
+
+struct DesignResult {
+    uint64_t index;
+    SimulatorConfig config;
+    uint64_t cycles, instructions;
+    double cost;
+    bool pareto;
+
+    double cpi() const { return instructions ? static_cast<double>(cycles) / instructions : 0.0; }
+};
+
+// Marks the results no other result beats on both CPI and cost.
+void markParetoFront(std::vector<DesignResult>& results);
+
+void writeDesignResults(std::ostream& out, const std::vector<DesignResult>& results);
+
+// Evaluates design points over a workload set.  Each (workload, point) run
+// goes to a work-stealing pool and stops after `instructionBudget` retired
+// instructions, when the program halts, or after `maxCycles`.  Results are
+// cached by (workload hash, config hash), so points that repeat, within one
+// call or across calls, are only simulated once.  With a result cache set,
+// runs are also looked up in and stored to it, so they carry over between
+// invocations.  With replay on, each workload is executed once to record its
+// instruction stream, and every point then replays that stream for timing
+// alone (see exectrace.hpp).  With decoupling on, each run instead executes
+// its workload on a second thread as it goes (see decoupled.hpp).  With
+// extrapolation on, runs skip through loops whose timing has settled (see
+// steadystate.hpp).
+class DesignSpaceExplorer {
+public:
+    DesignSpaceExplorer(const std::vector<Workload>& workloads, uint64_t instructionBudget, uint64_t maxCycles)
+        : workloads_(workloads), instructionBudget_(instructionBudget), maxCycles_(maxCycles),
+          resultCache_(nullptr), replay_(false), decoupled_(false), extrapolate_(false), simulations_(0), cacheHits_(0) {}
+
+    void setResultCache(const ResultCache* cache) { resultCache_ = cache; }
+    void setReplay(bool replay) { replay_ = replay; }
+    void setDecoupled(bool decoupled) { decoupled_ = decoupled; }
+    void setExtrapolate(bool extrapolate) { extrapolate_ = extrapolate; }
+
+    std::vector<DesignResult> evaluate(const std::vector<std::pair<uint64_t, SimulatorConfig> >& points,
+                                       unsigned threads);
+
+    uint64_t simulations() const { return simulations_; }
+    uint64_t cacheHits() const { return cacheHits_; }
+
+private:
+    void recordWorkloads(unsigned threads);
+    SimulatorStats simulate(size_t workload, const SimulatorConfig& config);
+
+    std::vector<Workload> workloads_;
+    uint64_t instructionBudget_, maxCycles_;
+    const ResultCache* resultCache_;
+    bool replay_, decoupled_, extrapolate_;
+    std::vector<std::shared_ptr<const ExecutionTrace> > traces_;   // per workload, when replaying
+
+    std::mutex cacheLock_;
+    std::map<std::pair<uint64_t, uint64_t>, SimulatorStats> cache_;
+    uint64_t simulations_, cacheHits_;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "energy.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+AluClass aluClass(Opcode opcode) {
+    switch (opcode) {
+        case AND: case OR: case XOR: case ANDI: case ORI: case XORI:
+            return ALU_LOGIC;
+        case SLL: case SRL: case SRA: case SLLI: case SRLI: case SRAI:
+            return ALU_SHIFT;
+        case SLT: case SLTU: case SLTI: case SLTIU:
+        case BEQ: case BNE: case BLT: case BGE: case BLTU: case BGEU:
+            return ALU_COMPARE;
+        default:
+            return ALU_ARITHMETIC;
+    }
+}
+
+bool EnergyCosts::load(std::istream& in, std::string& error) {
+    struct Field {
+        const char* name;
+        double* value;
+    } fields[] = {
+        {"instruction-fetch", &instructionFetch}, {"register-read", &registerRead},
+        {"register-write", &registerWrite}, {"alu-arithmetic", &alu[ALU_ARITHMETIC]},
+        {"alu-logic", &alu[ALU_LOGIC]}, {"alu-shift", &alu[ALU_SHIFT]}, {"alu-compare", &alu[ALU_COMPARE]},
+        {"forward", &forward}, {"data-read", &dataRead}, {"data-write", &dataWrite},
+        {"latch-write", &latchWrite}, {"leakage", &leakagePerCycle},
+    };
+
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::string name;
+        double value;
+        if (!(iss >> name)) continue;
+        if (!(iss >> value) || value < 0) {
+            error = "line " + std::to_string(number) + ": expected a non-negative energy for " + name;
+            return false;
+        }
+
+        bool known = false;
+        for (Field& field : fields) {
+            if (name == field.name) {
+                *field.value = value;
+                known = true;
+            }
+        }
+        if (!known) {
+            error = "line " + std::to_string(number) + ": unknown event " + name;
+            return false;
+        }
+    }
+    return true;
+}
+
+double EnergyModel::cost(ActivityEvent event, int opcode) const {
+    switch (event) {
+        case ACTIVITY_INSTRUCTION_FETCH: return costs_.instructionFetch;
+        case ACTIVITY_REGISTER_READ: return costs_.registerRead;
+        case ACTIVITY_REGISTER_WRITE: return costs_.registerWrite;
+        case ACTIVITY_ALU: return costs_.alu[aluClass(static_cast<Opcode>(opcode))];
+        case ACTIVITY_FORWARD: return costs_.forward;
+        case ACTIVITY_DATA_READ: return costs_.dataRead;
+        case ACTIVITY_DATA_WRITE: return costs_.dataWrite;
+        case ACTIVITY_LATCH_WRITE: return costs_.latchWrite;
+        default: return 0.0;
+    }
+}
+
+void EnergyModel::onActivity(Processor& cpu, ActivityEvent event, uint32_t pc, int opcode) {
+    double energy = cost(event, opcode);
+    events_[event]++;
+    if (event == ACTIVITY_ALU) aluOps_[aluClass(static_cast<Opcode>(opcode))]++;
+    dynamic_ += energy;
+    perPc_[pc] += energy;
+}
+
+void EnergyModel::writeReport(std::ostream& out, uint64_t cycles, uint64_t instructions) const {
+    double total = totalEnergy(cycles);
+    out << std::fixed << std::setprecision(1);
+    out << "cycles: " << cycles << ", instructions: " << instructions << ", CPI: " << std::setprecision(3)
+        << (instructions ? static_cast<double>(cycles) / instructions : 0.0) << "\n" << std::setprecision(1);
+    out << "total energy: " << total << " pJ (dynamic " << dynamic_ << ", leakage "
+        << costs_.leakagePerCycle * cycles << ")\n";
+    out << "energy per instruction: " << (instructions ? total / instructions : 0.0) << " pJ\n";
+    out << "energy-delay product: " << energyDelayProduct(cycles) << " pJ*cycles\n";
+
+    out << "\nevent,count,energy_pj\n";
+    struct Line {
+        const char* name;
+        uint64_t count;
+        double each;
+    } lines[] = {
+        {"instruction_fetch", events_[ACTIVITY_INSTRUCTION_FETCH], costs_.instructionFetch},
+        {"register_read", events_[ACTIVITY_REGISTER_READ], costs_.registerRead},
+        {"register_write", events_[ACTIVITY_REGISTER_WRITE], costs_.registerWrite},
+        {"alu_arithmetic", aluOps_[ALU_ARITHMETIC], costs_.alu[ALU_ARITHMETIC]},
+        {"alu_logic", aluOps_[ALU_LOGIC], costs_.alu[ALU_LOGIC]},
+        {"alu_shift", aluOps_[ALU_SHIFT], costs_.alu[ALU_SHIFT]},
+        {"alu_compare", aluOps_[ALU_COMPARE], costs_.alu[ALU_COMPARE]},
+        {"forward", events_[ACTIVITY_FORWARD], costs_.forward},
+        {"data_read", events_[ACTIVITY_DATA_READ], costs_.dataRead},
+        {"data_write", events_[ACTIVITY_DATA_WRITE], costs_.dataWrite},
+        {"latch_write", events_[ACTIVITY_LATCH_WRITE], costs_.latchWrite},
+    };
+    for (const Line& line : lines) out << line.name << "," << line.count << "," << line.count * line.each << "\n";
+
+    out << "\npc,energy_pj\n";
+    for (const auto& entry : perPc_) {
+        out << "0x" << std::hex << std::setw(8) << std::setfill('0') << entry.first << std::dec
+            << std::setfill(' ') << "," << entry.second << "\n";
+    }
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+}
@@ -0,0 +1,70 @@
+#ifndef ENERGY_HPP
+#define ENERGY_HPP
+
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+// Classes of ALU operation, which differ in switching energy.  Loads, stores
+// and jumps use the adder for their address or link value; branches use the
+// comparator.
+enum AluClass {
+    ALU_ARITHMETIC, ALU_LOGIC, ALU_SHIFT, ALU_COMPARE, ALU_CLASS_COUNT
+};
+
+AluClass aluClass(Opcode opcode);
+
+// Energy per event in picojoules, plus leakage per cycle.  The defaults are
+// rough figures for a small in-order core; `load` replaces any of them from
+// lines of the form "<name> <picojoules>", with '#' starting a comment.
+struct EnergyCosts {
+    double instructionFetch;
+    double registerRead, registerWrite;
+    double alu[ALU_CLASS_COUNT];
+    double forward;
+    double dataRead, dataWrite;
+    double latchWrite;
+    double leakagePerCycle;
+
+    EnergyCosts() : instructionFetch(8.0), registerRead(1.2), registerWrite(1.5), alu{0.5, 0.2, 0.4, 0.3},
+                    forward(0.1), dataRead(10.0), dataWrite(11.0), latchWrite(0.4), leakagePerCycle(2.0) {}
+
+    bool load(std::istream& in, std::string& error);
+};
+
+// Activity-based energy estimate.  Each datapath event reported by the stages
+// is charged to the instruction behind it, so the report gives both the total
+// and the energy spent per PC, wrong-path fetches included.  Leakage is only
+// added to the total.
+class EnergyModel : public PipelineObserver {
+public:
+    explicit EnergyModel(const EnergyCosts& costs = EnergyCosts()) : costs_(costs), events_(), aluOps_(),
+                                                                      dynamic_(0) {}
+
+    void onActivity(Processor& cpu, ActivityEvent event, uint32_t pc, int opcode) override;
+
+    double dynamicEnergy() const { return dynamic_; }
+    double totalEnergy(uint64_t cycles) const { return dynamic_ + costs_.leakagePerCycle * cycles; }
+
+    // Energy-delay product in picojoule-cycles.
+    double energyDelayProduct(uint64_t cycles) const { return totalEnergy(cycles) * cycles; }
+
+    const std::map<uint32_t, double>& perPc() const { return perPc_; }
+
+    void writeReport(std::ostream& out, uint64_t cycles, uint64_t instructions) const;
+
+private:
+    double cost(ActivityEvent event, int opcode) const;
+
+    EnergyCosts costs_;
+    uint64_t events_[ACTIVITY_EVENT_COUNT];
+    uint64_t aluOps_[ALU_CLASS_COUNT];
+    double dynamic_;
+    std::map<uint32_t, double> perPc_;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "exectrace.hpp"
+#include "byteorder.hpp"
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t kFormatVersion = 1;
+
+// Records are variable-length, so fields are read one at a time.
+static bool readField(std::istream& in, int bytes, uint64_t& value) {
+    unsigned char buffer[8];
+    if (!in.read(reinterpret_cast<char*>(buffer), bytes)) return false;
+    value = getLE(buffer, bytes);
+    return true;
+}
+
+static int instructionLength(const InstructionMemory& program, uint32_t pc) {
+    return InstructionMemory::isCompressed(program.readParcel(pc)) ? 2 : 4;
+}
+
+void ExecutionRecorder::append(uint32_t pc, uint8_t flags, uint32_t address, int32_t value) {
+    if (open_ && (trace_.records.back().taken() || pc != fallThrough_)) {
+        trace_.records.back().flags |= TraceRecord::TAKEN;
+        trace_.records.back().target = pc;
+    }
+    open_ = false;
+
+    TraceRecord record;
+    record.pc = pc;
+    record.flags = flags;
+    if (flags & (TraceRecord::LOAD | TraceRecord::STORE)) record.address = address;
+    if (flags & TraceRecord::LOAD) record.value = value;
+    trace_.records.push_back(record);
+}
+
+void ExecutionRecorder::onRetire(Processor& cpu, const MEM_WB_Register& retired) {
+    const Instruction& inst = retired.instruction;
+    uint32_t pc = retired.pc;
+
+    // The first half of a fused pair is never a memory op or a branch.
+    if (inst.fusion != FUSE_NONE) {
+        append(pc, 0, 0, 0);
+        pc += inst.length;
+    }
+
+    uint8_t flags = retired.control.memRead ? TraceRecord::LOAD : retired.control.memWrite ? TraceRecord::STORE : 0;
+    append(pc, flags, retired.aluResult, retired.readData);
+
+    // ID redirects fetch for every jump, even to the next instruction, so
+    // jumps are always taken; a branch is taken when its successor is not the
+    // instruction after it.
+    if (inst.format == B_TYPE || inst.format == J_TYPE || inst.opcode == JALR) {
+        if (inst.format != B_TYPE) trace_.records.back().flags |= TraceRecord::TAKEN;
+        open_ = true;
+        fallThrough_ = pc + instructionLength(cpu.instMem, pc);
+    }
+}
+
+void ExecutionRecorder::finish(const Processor& cpu) {
+    trace_.program = cpu.instMem;
+    if (!open_) return;
+
+    TraceRecord& last = trace_.records.back();
+    if (!cpu.halted()) {
+        trace_.records.pop_back();
+    } else if (last.taken() || cpu.pc != fallThrough_) {
+        last.flags |= TraceRecord::TAKEN;
+        last.target = cpu.pc;
+    }
+    open_ = false;
+}
+
+void recordExecution(Simulator& sim, uint64_t instructions, uint64_t maxCycles, ExecutionTrace& trace) {
+    const Processor& cpu = sim.processor();
+    trace.records.clear();
+
+    ExecutionRecorder recorder(trace);
+    sim.addObserver(&recorder);
+    while (trace.records.size() < instructions && !sim.halted() &&
+           static_cast<uint64_t>(cpu.clockCycle) < maxCycles) {
+        sim.step();
+    }
+    sim.removeObserver(&recorder);
+    recorder.finish(cpu);
+}
+
+void writeExecutionTrace(std::ostream& out, const ExecutionTrace& trace) {
+    out.write("RVIT", 4);
+    putLE(out, kFormatVersion, 4);
+    putLE(out, trace.program.parcels.size(), 4);
+    for (uint16_t parcel : trace.program.parcels) putLE(out, parcel, 2);
+    putLE(out, trace.records.size(), 8);
+    putLE(out, trace.records.empty() ? 0 : trace.records[0].pc, 4);
+
+    for (const TraceRecord& record : trace.records) {
+        putLE(out, record.flags, 1);
+        if (record.flags & (TraceRecord::LOAD | TraceRecord::STORE)) putLE(out, record.address, 4);
+        if (record.flags & TraceRecord::LOAD) putLE(out, static_cast<uint32_t>(record.value), 4);
+        if (record.taken()) putLE(out, record.target, 4);
+    }
+}
+
+bool readExecutionTrace(std::istream& in, ExecutionTrace& trace, std::string& error) {
+    char magic[4];
+    uint64_t version, parcels, count, pc;
+    if (!in.read(magic, 4) || std::memcmp(magic, "RVIT", 4) != 0 || !readField(in, 4, version) ||
+        version != kFormatVersion) {
+        error = "not an execution trace";
+        return false;
+    }
+
+    trace = ExecutionTrace();
+    error = "truncated execution trace";
+    if (!readField(in, 4, parcels)) return false;
+    for (uint64_t i = 0; i < parcels; i++) {
+        uint64_t parcel;
+        if (!readField(in, 2, parcel)) return false;
+        trace.program.appendParcel(parcel);
+    }
+    if (!readField(in, 8, count) || !readField(in, 4, pc)) return false;
+
+    trace.records.reserve(std::min<uint64_t>(count, 1 << 20));
+    for (uint64_t i = 0; i < count; i++) {
+        if (!trace.program.contains(pc)) {
+            error = "execution trace leaves its program";
+            return false;
+        }
+        TraceRecord record;
+        uint64_t field;
+        record.pc = pc;
+        if (!readField(in, 1, field)) return false;
+        record.flags = field;
+        if (record.flags & (TraceRecord::LOAD | TraceRecord::STORE)) {
+            if (!readField(in, 4, field)) return false;
+            record.address = field;
+        }
+        if (record.flags & TraceRecord::LOAD) {
+            if (!readField(in, 4, field)) return false;
+            record.value = static_cast<int32_t>(field);
+        }
+        if (record.taken()) {
+            if (!readField(in, 4, field)) return false;
+            record.target = field;
+        }
+        trace.records.push_back(record);
+        pc = record.taken() ? record.target : pc + instructionLength(trace.program, pc);
+    }
+    error.clear();
+    return true;
+}
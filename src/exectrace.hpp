@@ -0,0 +1,54 @@
+#ifndef EXECTRACE_HPP
+#define EXECTRACE_HPP
+
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+class Simulator;
+
+// Builds an ExecutionTrace from the instructions a run retires.  A control
+// transfer's record is completed by the next instruction to retire, so after
+// the run finish() resolves the last one from where the halted program went,
+// or drops it, and stores the program.
+//
+// Binary file layout (little-endian):
+//     char[4]  magic "RVIT"
+//     uint32   version (1)
+//     uint32   program parcel count, then that many uint16 parcels
+//     uint64   record count
+//     uint32   PC of the first record
+//     records, 1 to 13 bytes each:
+//         uint8  flags (TraceRecord::Flags)
+//         uint32 address       loads and stores
+//         uint32 value         loads
+//         uint32 target        taken control transfers
+// A record's PC is the previous record's target when that one was taken and
+// the instruction after it otherwise, so it is not stored.
+class ExecutionRecorder : public PipelineObserver {
+public:
+    explicit ExecutionRecorder(ExecutionTrace& trace) : trace_(trace), open_(false) {}
+
+    void onRetire(Processor& cpu, const MEM_WB_Register& retired) override;
+    void finish(const Processor& cpu);
+
+private:
+    void append(uint32_t pc, uint8_t flags, uint32_t address, int32_t value);
+
+    ExecutionTrace& trace_;
+    bool open_;   // the last record is a control transfer awaiting its successor
+    uint32_t fallThrough_;
+};
+
+// Runs `sim` from its current state until it has retired `instructions`
+// instructions, halted or spent `maxCycles` cycles, and records what it
+// retired along with its program.
+void recordExecution(Simulator& sim, uint64_t instructions, uint64_t maxCycles, ExecutionTrace& trace);
+
+void writeExecutionTrace(std::ostream& out, const ExecutionTrace& trace);
+bool readExecutionTrace(std::istream& in, ExecutionTrace& trace, std::string& error);
+
+#endif
@@ -0,0 +1,119 @@
+#include "dse.hpp"
+#include "parsenumber.hpp"
+
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Reads the value of a numeric flag, reporting it when it is not a number
+// in [min, max].
+static bool readNumber(const char* text, long long min, long long max, const std::string& what, long long& value) {
+    if (parseNumber(text, min, max, value)) return true;
+    std::cerr << "Error: bad " << what << " " << text << std::endl;
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<Workload> workloads;
+    DesignSpace space;
+    uint64_t samples = 0;
+    uint64_t seed = 1;
+    unsigned threads = 0;
+    uint64_t instructionBudget = 1000;
+    uint64_t maxCycles = 100000;
+    std::string outputFile;
+    std::string resultCacheDir;
+    bool replay = false;
+    bool decoupled = false;
+    bool extrapolate = false;
+    long long number;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string error;
+        if (arg == "--space" && i + 1 < argc) {
+            if (!space.parse(argv[++i], error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+        } else if (arg == "--sample" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "sample count", number)) return 1;
+            samples = number;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "seed", number)) return 1;
+            seed = number;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, 1024, "thread count", number)) return 1;
+            threads = number;
+        } else if (arg == "--instructions" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 1, LLONG_MAX, "instruction budget", number)) return 1;
+            instructionBudget = number;
+        } else if (arg == "--max-cycles" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 1, LLONG_MAX, "cycle limit", number)) return 1;
+            maxCycles = number;
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "--result-cache" && i + 1 < argc) {
+            resultCacheDir = argv[++i];
+        } else if (arg == "--replay") {
+            replay = true;
+        } else if (arg == "--decoupled") {
+            decoupled = true;
+        } else if (arg == "--extrapolate") {
+            extrapolate = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            Workload workload;
+            if (!parseWorkload(arg, workload, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            workloads.push_back(workload);
+        }
+    }
+
+    if (workloads.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <program>[:x<n>=<value>...][:@<data>] [<program>...] "
+                  << "[--space <param>=<v>[,<v>...]] [--sample <n>] [--seed <n>] [--threads <n>] "
+                  << "[--instructions <n>] [--max-cycles <n>] [--out <file>] "
+                  << "[--result-cache <dir>] [--replay] [--decoupled] [--extrapolate]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<uint64_t, SimulatorConfig> > points;
+    for (uint64_t index : space.sample(samples ? samples : space.size(), seed)) {
+        points.push_back(std::make_pair(index, space.point(index, SimulatorConfig())));
+    }
+
+    DesignSpaceExplorer explorer(workloads, instructionBudget, maxCycles);
+    ResultCache resultCache(resultCacheDir);
+    if (!resultCacheDir.empty()) explorer.setResultCache(&resultCache);
+    explorer.setReplay(replay);
+    explorer.setDecoupled(decoupled);
+    explorer.setExtrapolate(extrapolate);
+    std::vector<DesignResult> results = explorer.evaluate(points, threads);
+
+    std::cout << "Evaluated " << points.size() << " of " << space.size() << " design points on "
+              << workloads.size() << " workloads: " << explorer.simulations() << " simulations, "
+              << explorer.cacheHits() << " cached" << std::endl;
+    std::cout << "Pareto front (CPI vs cost):" << std::endl;
+    std::vector<DesignResult> front;
+    for (const DesignResult& result : results) {
+        if (result.pareto) front.push_back(result);
+    }
+    writeDesignResults(std::cout, front);
+
+    if (!outputFile.empty()) {
+        std::ofstream out(outputFile);
+        if (!out) {
+            std::cerr << "Error opening output file: " << outputFile << std::endl;
+            return 1;
+        }
+        writeDesignResults(out, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "functional.hpp"
+#include "pipeline.hpp"
+
+bool executeInstruction(Processor& cpu, TraceRecord* record) {
+    uint32_t pc = cpu.pc;
+    if (!cpu.instMem.contains(pc)) return false;
+
+    Instruction inst;
+    ControlSignals control;
+    cpu.decodeInstruction(cpu.instMem.readInstruction(pc), inst);
+    cpu.setControlSignals(inst, control);
+
+    int32_t rs1Value = cpu.regFile.read(inst.rs1);
+    int32_t rs2Value = cpu.regFile.read(inst.rs2);
+    int32_t result = aluResult(inst, pc, rs1Value, control.aluSrc ? inst.immediate : rs2Value, rs2Value);
+
+    int32_t loaded = 0;
+    if (control.memRead) {
+        loaded = readDataMemory(cpu.dataMem, inst.opcode, result);
+    } else if (control.memWrite) {
+        writeDataMemory(cpu.dataMem, inst.opcode, result, rs2Value);
+    }
+    if (control.regWrite) cpu.regFile.write(inst.rd, control.memToReg ? loaded : result);
+
+    uint32_t target = 0;
+    bool taken = resolveBranch(inst, pc, rs1Value, rs2Value, target);
+    cpu.pc = taken ? target : pc + inst.length;
+
+    if (record) {
+        *record = TraceRecord();
+        record->pc = pc;
+        if (control.memRead) record->flags |= TraceRecord::LOAD;
+        if (control.memWrite) record->flags |= TraceRecord::STORE;
+        if (control.memRead || control.memWrite) record->address = result;
+        if (control.memRead) record->value = loaded;
+        if (control.memWrite) record->value = rs2Value;
+        if (taken) {
+            record->flags |= TraceRecord::TAKEN;
+            record->target = target;
+        }
+    }
+    return true;
+}
+
+static void copyArchitecturalState(const Processor& from, Processor& to) {
+    to.instMem = from.instMem;
+    to.regFile = from.regFile;
+    to.dataMem = from.dataMem;
+    to.pc = from.pc;
+}
+
+FunctionalTraceSource::FunctionalTraceSource(const Processor& start, size_t history)
+    : behindCount_(0), first_(0), released_(0), history_(history), ended_(false) {
+    copyArchitecturalState(start, ahead_);
+    copyArchitecturalState(start, behind_);
+}
+
+const TraceRecord* FunctionalTraceSource::record(size_t index) {
+    if (index < first_) return nullptr;
+    while (index >= first_ + records_.size() && !ended_) {
+        TraceRecord record;
+        if (executeInstruction(ahead_, &record)) records_.push_back(record);
+        else ended_ = true;
+    }
+    return index < first_ + records_.size() ? &records_[index - first_] : nullptr;
+}
+
+void FunctionalTraceSource::release(size_t index) {
+    if (index <= released_) return;
+    released_ = index;
+    while (!records_.empty() && first_ + history_ < released_) {
+        records_.pop_front();
+        first_++;
+    }
+    // A fused pair in MEM/WB has been released but not yet written back.
+    if (released_ > 2) retired(released_ - 2);
+}
+
+const Processor& FunctionalTraceSource::retired(uint64_t count) {
+    for (; behindCount_ < count && executeInstruction(behind_); behindCount_++) {}
+    return behind_;
+}
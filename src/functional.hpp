@@ -0,0 +1,45 @@
+#ifndef FUNCTIONAL_HPP
+#define FUNCTIONAL_HPP
+
+#include "processor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Architectural-only execution: runs the instruction at cpu.pc to completion
+// on the registers and data memory and moves cpu.pc past it, with the same
+// datapath the pipeline uses but none of its latches, timing or counters.
+// Returns false, changing nothing, once cpu.pc has left the program.  When
+// `record` is given it receives the instruction's TraceRecord, with the
+// branch outcome as ID resolves it.
+bool executeInstruction(Processor& cpu, TraceRecord* record = nullptr);
+
+// A TraceSource that executes the program on the calling thread as records
+// are asked for.  Released records are kept until `history` newer ones have
+// been released, so a consumer can still look back that far.  A second,
+// lagging copy of the architectural state follows the releases, from which
+// retired() gives the state after any point the consumer has not yet
+// released.
+class FunctionalTraceSource : public TraceSource {
+public:
+    FunctionalTraceSource(const Processor& start, size_t history);
+
+    const TraceRecord* record(size_t index) override;   // nullptr when released or past the end
+    void release(size_t index) override;
+
+    // The architectural state after the first `count` instructions, which
+    // must not be before a record released more than two records ago.
+    const Processor& retired(uint64_t count);
+
+private:
+    Processor ahead_, behind_;
+    uint64_t behindCount_;
+    std::deque<TraceRecord> records_;
+    size_t first_;      // index of records_.front()
+    size_t released_;
+    size_t history_;
+    bool ended_;
+};
+
+#endif
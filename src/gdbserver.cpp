@@ -0,0 +1,54 @@
+#include "gdbstub.hpp"
+#include "parsenumber.hpp"
+#include "simulator.hpp"
+
+#include <climits>
+#include <iostream>
+#include <string>
+
+static int usage(const char* program) {
+    std::cerr << "Usage: " << program << " <filename> <port> [--no-forwarding] [--history <interval>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) return usage(argv[0]);
+
+    std::string file = argv[1];
+    long long port;
+    if (!parseNumber(argv[2], 0, 65535, port)) {
+        std::cerr << "Bad port: " << argv[2] << std::endl;
+        return usage(argv[0]);
+    }
+
+    SimulatorConfig config;
+    config.traceEnabled = false;
+    long long historyInterval = 0;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-forwarding") {
+            config.forwarding = false;
+        } else if (arg == "--history" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], 0, INT_MAX, historyInterval)) {
+                std::cerr << "Bad history interval: " << argv[i] << std::endl;
+                return usage(argv[0]);
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return usage(argv[0]);
+        }
+    }
+
+    Simulator sim(config);
+    if (!sim.loadProgram(file)) return 1;
+    if (historyInterval > 0) sim.enableHistory(historyInterval);
+
+    GdbServer server(sim);
+    if (!server.listen(port)) return 1;
+
+    std::cout << "Listening for gdb on 127.0.0.1:" << server.port() << std::endl;
+    server.serve();
+
+    return 0;
+}
@@ -0,0 +1,476 @@
+#include "gdbstub.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* kTargetXml =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<architecture>riscv:rv32</architecture>"
+    "<feature name=\"org.gnu.gdb.riscv.cpu\">"
+    "<reg name=\"zero\" bitsize=\"32\" type=\"int\" regnum=\"0\"/>"
+    "<reg name=\"ra\" bitsize=\"32\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"gp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"tp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"t0\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"fp\" bitsize=\"32\" type=\"data_ptr\"/>"
+    "<reg name=\"s1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a0\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a1\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"a7\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s2\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s7\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s8\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s9\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s10\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"s11\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t3\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t4\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t5\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"t6\" bitsize=\"32\" type=\"int\"/>"
+    "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+    "</feature>"
+    "</target>";
+
+static const int kPcRegister = 32;
+
+static std::string toHex(uint32_t value, int bytes) {
+    // Registers and memory travel in target (little-endian) byte order.
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (int i = 0; i < bytes; i++) {
+        uint8_t byte = (value >> (8 * i)) & 0xFF;
+        out += digits[byte >> 4];
+        out += digits[byte & 0xF];
+    }
+    return out;
+}
+
+static uint32_t fromHexLE(const std::string& hex) {
+    uint32_t value = 0;
+    for (size_t i = 0; i + 1 < hex.size() && i < 8; i += 2) {
+        value |= static_cast<uint32_t>(std::strtoul(hex.substr(i, 2).c_str(), nullptr, 16)) << (4 * i);
+    }
+    return value;
+}
+
+static std::string hexEncode(const std::string& text) {
+    std::string out;
+    for (unsigned char c : text) out += toHex(c, 1);
+    return out;
+}
+
+static std::string hexDecode(const std::string& hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out += static_cast<char>(std::strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+    }
+    return out;
+}
+
+// Parses "addr,length" (both hex) starting at `pos`.
+static bool parseAddressLength(const std::string& text, size_t pos, uint32_t& address, uint32_t& length) {
+    size_t comma = text.find(',', pos);
+    if (comma == std::string::npos) return false;
+    address = std::strtoul(text.substr(pos, comma - pos).c_str(), nullptr, 16);
+    length = std::strtoul(text.substr(comma + 1).c_str(), nullptr, 16);
+    return true;
+}
+
+GdbServer::GdbServer(Simulator& sim)
+    : sim_(sim), listenFd_(-1), clientFd_(-1), port_(0), cycleStep_(false), noAckMode_(false) {}
+
+GdbServer::~GdbServer() {
+    sim_.removeObserver(&watchpoints_);
+    if (clientFd_ >= 0) close(clientFd_);
+    if (listenFd_ >= 0) close(listenFd_);
+}
+
+bool GdbServer::listen(int port) {
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        std::perror("socket");
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd_, 1) < 0) {
+        std::perror("bind");
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+    return true;
+}
+
+bool GdbServer::serve() {
+    clientFd_ = accept(listenFd_, nullptr, nullptr);
+    if (clientFd_ < 0) {
+        std::perror("accept");
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(clientFd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    bool done = false;
+    std::string packet;
+    while (!done && readPacket(packet)) {
+        std::string reply = handlePacket(packet, done);
+        if (!sendPacket(reply)) break;
+    }
+
+    close(clientFd_);
+    clientFd_ = -1;
+    return true;
+}
+
+bool GdbServer::readPacket(std::string& packet) {
+    for (;;) {
+        size_t start = input_.find('$');
+        size_t hash = start == std::string::npos ? std::string::npos : input_.find('#', start);
+        if (hash != std::string::npos && hash + 2 < input_.size()) {
+            packet = input_.substr(start + 1, hash - start - 1);
+            input_.erase(0, hash + 3);
+            if (!noAckMode_ && send(clientFd_, "+", 1, 0) != 1) return false;
+            return true;
+        }
+
+        char buffer[4096];
+        ssize_t received = recv(clientFd_, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        input_.append(buffer, received);
+    }
+}
+
+bool GdbServer::sendPacket(const std::string& data) {
+    unsigned checksum = 0;
+    for (unsigned char c : data) checksum += c;
+
+    char trailer[4];
+    std::snprintf(trailer, sizeof(trailer), "#%02x", checksum & 0xFF);
+    std::string frame = "$" + data + trailer;
+
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = send(clientFd_, frame.data() + sent, frame.size() - sent, 0);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool GdbServer::interruptPending() {
+    pollfd descriptor;
+    descriptor.fd = clientFd_;
+    descriptor.events = POLLIN;
+    if (poll(&descriptor, 1, 0) <= 0) return false;
+
+    char buffer[256];
+    ssize_t received = recv(clientFd_, buffer, sizeof(buffer), 0);
+    if (received <= 0) return true;
+
+    bool interrupt = false;
+    for (ssize_t i = 0; i < received; i++) {
+        if (buffer[i] == 0x03) interrupt = true;
+        else input_ += buffer[i];
+    }
+    return interrupt;
+}
+
+uint32_t GdbServer::architecturalPc() const {
+    const Processor& cpu = sim_.processor();
+    if (cpu.memWb.valid) return cpu.memWb.pc;
+    if (cpu.exMem.valid) return cpu.exMem.pc;
+    if (cpu.idEx.valid) return cpu.idEx.pc;
+    if (cpu.ifId.valid) return cpu.ifId.pc;
+    if (!cpu.fetchQueue.empty()) return cpu.fetchQueue.front().pc;
+    return cpu.pc;
+}
+
+std::string GdbServer::handlePacket(const std::string& packet, bool& done) {
+    if (packet.empty()) return "";
+    Processor& cpu = sim_.processor();
+
+    switch (packet[0]) {
+        case '?':
+            return "S05";
+
+        case 'g': {
+            std::string out;
+            for (int i = 0; i < 32; i++) out += toHex(cpu.regFile.read(i), 4);
+            out += toHex(architecturalPc(), 4);
+            return out;
+        }
+
+        case 'G': {
+            uint32_t pc = architecturalPc();
+            for (size_t i = 1; i < 32 && 1 + 8 * (i + 1) <= packet.size(); i++) {
+                sim_.writeRegister(i, fromHexLE(packet.substr(1 + 8 * i, 8)));
+            }
+            if (1 + 8 * (kPcRegister + 1) <= packet.size()) pc = fromHexLE(packet.substr(1 + 8 * kPcRegister, 8));
+            sim_.redirect(pc);
+            return "OK";
+        }
+
+        case 'p': {
+            int reg = std::strtol(packet.c_str() + 1, nullptr, 16);
+            if (reg == kPcRegister) return toHex(architecturalPc(), 4);
+            if (reg >= 0 && reg < 32) return toHex(cpu.regFile.read(reg), 4);
+            return "E01";
+        }
+
+        case 'P': {
+            size_t equals = packet.find('=');
+            if (equals == std::string::npos) return "E01";
+            int reg = std::strtol(packet.c_str() + 1, nullptr, 16);
+            uint32_t value = fromHexLE(packet.substr(equals + 1));
+            uint32_t pc = architecturalPc();
+            if (reg == kPcRegister) pc = value;
+            else if (reg > 0 && reg < 32) sim_.writeRegister(reg, value);
+            else if (reg != 0) return "E01";
+            sim_.redirect(pc);
+            return "OK";
+        }
+
+        case 'm': {
+            uint32_t address, length;
+            if (!parseAddressLength(packet, 1, address, length)) return "E01";
+            if (address > cpu.dataMem.size() || length > cpu.dataMem.size() - address) return "E14";
+            std::string out;
+            for (uint32_t i = 0; i < length; i++) out += toHex(cpu.dataMem.readByte(address + i), 1);
+            return out;
+        }
+
+        case 'M': {
+            uint32_t address, length;
+            size_t colon = packet.find(':');
+            if (colon == std::string::npos || !parseAddressLength(packet.substr(0, colon), 1, address, length)) return "E01";
+            if (address > cpu.dataMem.size() || length > cpu.dataMem.size() - address) return "E14";
+            std::string bytes = hexDecode(packet.substr(colon + 1));
+            for (uint32_t i = 0; i < length && i < bytes.size(); i++) {
+                sim_.writeMemory(address + i, static_cast<uint8_t>(bytes[i]), 1);
+            }
+            sim_.redirect(architecturalPc());
+            return "OK";
+        }
+
+        case 'c':
+        case 's':
+            if (packet.size() > 1) sim_.redirect(std::strtoul(packet.c_str() + 1, nullptr, 16));
+            return resume(packet[0] == 's');
+
+        case 'b':
+            if (packet == "bs" || packet == "bc") return reverse(packet == "bs");
+            return "";
+
+        case 'Z':
+        case 'z':
+            return handleBreakpoint(packet, packet[0] == 'Z');
+
+        case 'H':
+            return "OK";
+
+        case 'T':
+            return "OK";
+
+        case 'q':
+        case 'Q':
+            return handleQuery(packet);
+
+        case 'D':
+            done = true;
+            return "OK";
+
+        case 'k':
+            done = true;
+            return "OK";
+
+        default:
+            return "";
+    }
+}
+
+std::string GdbServer::handleQuery(const std::string& packet) {
+    if (packet.compare(0, 10, "qSupported") == 0) {
+        std::string features = "PacketSize=4000;swbreak+;hwbreak+;qXfer:features:read+;QStartNoAckMode+";
+        if (sim_.history()) features += ";ReverseStep+;ReverseContinue+";
+        return features;
+    }
+    if (packet == "QStartNoAckMode") {
+        noAckMode_ = true;
+        return "OK";
+    }
+    if (packet == "qAttached") return "1";
+    if (packet == "qC") return "QC1";
+    if (packet == "qfThreadInfo") return "m1";
+    if (packet == "qsThreadInfo") return "l";
+    if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0) {
+        uint32_t offset, length;
+        if (!parseAddressLength(packet, 31, offset, length)) return "E01";
+        std::string xml = kTargetXml;
+        if (offset >= xml.size()) return "l";
+        std::string chunk = xml.substr(offset, length);
+        return (offset + chunk.size() >= xml.size() ? "l" : "m") + chunk;
+    }
+    if (packet.compare(0, 6, "qRcmd,") == 0) return handleMonitor(hexDecode(packet.substr(6)));
+    return "";
+}
+
+std::string GdbServer::handleMonitor(const std::string& command) {
+    if (command == "stepmode cycle") {
+        cycleStep_ = true;
+        return hexEncode("stepi now advances one clock cycle\n");
+    }
+    if (command == "stepmode instruction") {
+        cycleStep_ = false;
+        return hexEncode("stepi now advances one retired instruction\n");
+    }
+    if (command == "cycle") {
+        return hexEncode("cycle " + std::to_string(sim_.processor().clockCycle) + "\n");
+    }
+    if (command == "reset") {
+        sim_.reset();
+        return hexEncode("reset to cycle 0\n");
+    }
+    return hexEncode("unknown command; try stepmode instruction|cycle, cycle, reset\n");
+}
+
+std::string GdbServer::handleBreakpoint(const std::string& packet, bool insert) {
+    // Z<type>,<addr>,<kind>
+    if (packet.size() < 4) return "E01";
+    char type = packet[1];
+    uint32_t address, length;
+    if (!parseAddressLength(packet, 3, address, length)) return "E01";
+
+    if (type == '0' || type == '1') {
+        if (insert) breakpoints_.insert(address);
+        else breakpoints_.erase(address);
+        return "OK";
+    }
+
+    WatchpointSet::Kind kind;
+    switch (type) {
+        case '2': kind = WatchpointSet::WATCH_WRITE; break;
+        case '3': kind = WatchpointSet::WATCH_READ; break;
+        case '4': kind = WatchpointSet::WATCH_ACCESS; break;
+        default: return "";
+    }
+
+    bool wasEmpty = watchpoints_.empty();
+    if (insert) {
+        if (!watchpoints_.add(address, length, kind)) return "E01";
+    } else if (!watchpoints_.remove(address, length, kind)) {
+        return "E01";
+    }
+
+    // Only stay on the observer list while there is something to watch.
+    if (wasEmpty && !watchpoints_.empty()) sim_.addObserver(&watchpoints_);
+    if (!wasEmpty && watchpoints_.empty()) sim_.removeObserver(&watchpoints_);
+    return "OK";
+}
+
+std::string GdbServer::resume(bool singleStep) {
+    Processor& cpu = sim_.processor();
+    // An instruction step retires the instruction at the architectural PC and
+    // stops once its successor is next in line.
+    int targetRetired = cpu.instructionsExecuted + 1;
+
+    for (uint64_t n = 0;; n++) {
+        if (cpu.halted()) return "W00";
+
+        sim_.step(1);
+
+        if (watchpoints_.hitPending()) {
+            const WatchpointSet::Hit& hit = watchpoints_.lastHit();
+            watchpoints_.clearHit();
+            const char* reason = hit.watchpoint.kind == WatchpointSet::WATCH_WRITE ? "watch" :
+                                 hit.watchpoint.kind == WatchpointSet::WATCH_READ ? "rwatch" : "awatch";
+            char reply[64];
+            std::snprintf(reply, sizeof(reply), "T05%s:%x;", reason, hit.access.address);
+            return reply;
+        }
+
+        if (singleStep) {
+            if (cycleStep_) return "S05";
+            if (cpu.memWb.valid && cpu.instructionsExecuted >= targetRetired) return "S05";
+        } else if (breakpoints_.any() && cpu.memWb.valid && breakpoints_.test(cpu.memWb.pc)) {
+            return "T05swbreak:;";
+        }
+
+        if ((n & 0xFFF) == 0xFFF && interruptPending()) return "S02";
+    }
+}
+
+std::string GdbServer::reverse(bool singleStep) {
+    if (!sim_.history()) return "E01";
+
+    Processor& cpu = sim_.processor();
+    uint64_t now = cpu.clockCycle;
+    int retired = cpu.instructionsExecuted;
+    uint64_t interval = sim_.history()->interval();
+
+    // Walk back one checkpoint interval at a time, replaying each window
+    // forward and remembering the last cycle that satisfies the stop
+    // condition.
+    uint64_t windowEnd = now;
+    for (;;) {
+        uint64_t start = windowEnd > interval ? ((windowEnd - 1) / interval) * interval : 0;
+        sim_.goToCycle(start);
+
+        uint64_t found = 0;
+        bool hit = false;
+        while (static_cast<uint64_t>(cpu.clockCycle) < windowEnd) {
+            sim_.step(1);
+            bool match = singleStep ? (cpu.memWb.valid && cpu.instructionsExecuted < retired)
+                                    : (cpu.memWb.valid && breakpoints_.test(cpu.memWb.pc));
+            if (match && static_cast<uint64_t>(cpu.clockCycle) < now) {
+                found = cpu.clockCycle;
+                hit = true;
+            }
+        }
+        watchpoints_.clearHit();
+
+        if (hit) {
+            sim_.goToCycle(found);
+            return singleStep ? "S05" : "T05swbreak:;";
+        }
+        if (start == 0) {
+            sim_.goToCycle(0);
+            return "T05replaylog:begin;";
+        }
+        windowEnd = start;
+    }
+}
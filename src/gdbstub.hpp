@@ -0,0 +1,67 @@
+#ifndef GDBSTUB_HPP
+#define GDBSTUB_HPP
+
+#include "simulator.hpp"
+#include "watchpoint.hpp"
+
+#include <cstdint>
+#include <string>
+
+// GDB remote serial protocol server for one Simulator, listening on a
+// localhost TCP port.  Connect with
+//
+//     gdb-multiarch -ex 'target remote :1234'
+//
+// The architectural state shown to gdb is that of the oldest instruction
+// still in flight: the PC is the PC of the instruction about to retire and
+// the register file holds the results of everything older.  Breakpoints
+// fire when the instruction at that PC reaches MEM/WB, and are looked up in
+// a per-PC bitmap only when at least one is set.  Writing registers, memory
+// or the PC flushes the pipeline and refetches from the architectural PC, so
+// younger instructions never see stale operands.
+//
+// Data memory is exposed through the m/M packets; instruction memory is a
+// separate address space and is not visible to gdb.
+//
+// Monitor commands (`monitor <cmd>` in gdb):
+//     stepmode instruction|cycle   granularity of `stepi`
+//     cycle                        print the current cycle
+//     reset                        restart the program from cycle 0
+class GdbServer {
+public:
+    explicit GdbServer(Simulator& sim);
+    ~GdbServer();
+
+    // Bind 127.0.0.1:port; port 0 picks a free port.
+    bool listen(int port);
+    int port() const { return port_; }
+
+    // Accept one debugger connection and serve it until it detaches, kills
+    // the target or disconnects.
+    bool serve();
+
+private:
+    bool readPacket(std::string& packet);
+    bool sendPacket(const std::string& data);
+    bool interruptPending();
+
+    std::string handlePacket(const std::string& packet, bool& done);
+    std::string handleQuery(const std::string& packet);
+    std::string handleMonitor(const std::string& command);
+    std::string handleBreakpoint(const std::string& packet, bool insert);
+
+    std::string resume(bool singleStep);
+    std::string reverse(bool singleStep);
+
+    uint32_t architecturalPc() const;
+
+    Simulator& sim_;
+    int listenFd_, clientFd_, port_;
+    BreakpointSet breakpoints_;
+    WatchpointSet watchpoints_;
+    bool cycleStep_;
+    bool noAckMode_;
+    std::string input_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "history.hpp"
+
+#include <algorithm>
+
+SnapshotHistory::SnapshotHistory(int interval, int keyframeEvery)
+    : interval_(interval > 0 ? interval : 1),
+      keyframeEvery_(keyframeEvery > 0 ? keyframeEvery : 1) {}
+
+size_t SnapshotHistory::storedPages() const {
+    size_t count = 0;
+    for (const auto& checkpoint : checkpoints_) count += checkpoint.pages.size();
+    return count;
+}
+
+void SnapshotHistory::clear() {
+    checkpoints_.clear();
+    lastRegisters_ = RegisterFile();
+    lastPages_.clear();
+}
+
+void SnapshotHistory::record(const Processor& cpu) {
+    Checkpoint checkpoint;
+    cpu.savePipelineState(checkpoint.state);
+    checkpoint.keyframe = checkpoints_.size() % keyframeEvery_ == 0 ||
+                          lastPages_.size() != cpu.dataMem.pages.size();
+
+    for (int i = 0; i < 32; i++) {
+        if (checkpoint.keyframe || cpu.regFile.registers[i] != lastRegisters_.registers[i]) {
+            checkpoint.registers.push_back(std::make_pair(static_cast<uint8_t>(i), cpu.regFile.registers[i]));
+        }
+    }
+
+    for (size_t i = 0; i < cpu.dataMem.pages.size(); i++) {
+        if (checkpoint.keyframe || cpu.dataMem.pages[i] != lastPages_[i]) {
+            checkpoint.pages.push_back(std::make_pair(static_cast<uint32_t>(i), cpu.dataMem.pages[i]));
+        }
+    }
+
+    lastRegisters_ = cpu.regFile;
+    lastPages_ = cpu.dataMem.pages;
+    checkpoints_.push_back(checkpoint);
+}
+
+bool SnapshotHistory::restoreNearest(Processor& cpu, int cycle) const {
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), cycle,
+                               [](int c, const Checkpoint& checkpoint) { return c < checkpoint.state.clockCycle; });
+    if (it == checkpoints_.begin()) return false;
+    size_t target = (it - checkpoints_.begin()) - 1;
+
+    size_t base = target;
+    while (!checkpoints_[base].keyframe) base--;
+
+    RegisterFile registers;
+    std::vector<PagePtr> pages(cpu.dataMem.pages.size());
+    for (size_t k = base; k <= target; k++) {
+        for (const auto& reg : checkpoints_[k].registers) registers.registers[reg.first] = reg.second;
+        for (const auto& page : checkpoints_[k].pages) {
+            if (page.first < pages.size()) pages[page.first] = page.second;
+        }
+    }
+
+    cpu.restorePipelineState(checkpoints_[target].state);
+    cpu.regFile = registers;
+    cpu.dataMem.pages = pages;
+    return true;
+}
+
+void SnapshotHistory::discardAfter(int cycle) {
+    while (!checkpoints_.empty() && checkpoints_.back().state.clockCycle > cycle) checkpoints_.pop_back();
+    rebuildLast();
+}
+
+void SnapshotHistory::rebuildLast() {
+    lastRegisters_ = RegisterFile();
+    lastPages_.clear();
+    if (checkpoints_.empty()) return;
+
+    size_t base = checkpoints_.size() - 1;
+    while (!checkpoints_[base].keyframe) base--;
+
+    lastPages_.resize(checkpoints_[base].pages.size());
+    for (size_t k = base; k < checkpoints_.size(); k++) {
+        for (const auto& reg : checkpoints_[k].registers) lastRegisters_.registers[reg.first] = reg.second;
+        for (const auto& page : checkpoints_[k].pages) {
+            if (page.first < lastPages_.size()) lastPages_[page.first] = page.second;
+        }
+    }
+}
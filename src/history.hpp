@@ -0,0 +1,70 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include "processor.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Periodic checkpoints of a Processor for reverse execution.
+//
+// A checkpoint is taken every `interval` cycles.  Each one stores the full
+// pipeline state (it is only a few hundred bytes) but registers and memory
+// are delta-encoded against the previous checkpoint: only changed registers
+// and only pages that were written since are kept.  Because DataMemory pages
+// are copy-on-write, a page is dirty exactly when its pointer differs from
+// the one seen at the previous checkpoint.  Every `keyframeEvery`
+// checkpoints a full register file and page table is stored so a restore
+// never has to apply more than that many deltas.
+class SnapshotHistory {
+public:
+    explicit SnapshotHistory(int interval, int keyframeEvery = 16);
+
+    int interval() const { return interval_; }
+    size_t size() const { return checkpoints_.size(); }
+    size_t storedPages() const;
+
+    void clear();
+
+    // Record a checkpoint at the processor's current cycle.
+    void record(const Processor& cpu);
+
+    void maybeRecord(const Processor& cpu) {
+        if (cpu.clockCycle % interval_ == 0 &&
+            (checkpoints_.empty() || cpu.clockCycle > checkpoints_.back().state.clockCycle)) {
+            record(cpu);
+        }
+    }
+
+    // Restore the newest checkpoint at or before `cycle`.  Returns false if
+    // there is none.
+    bool restoreNearest(Processor& cpu, int cycle) const;
+
+    // Forget checkpoints taken after `cycle`, e.g. once the machine state has
+    // been edited and that future no longer follows from it.
+    void discardAfter(int cycle);
+
+private:
+    typedef std::shared_ptr<DataMemory::Page> PagePtr;
+
+    struct Checkpoint {
+        PipelineState state;
+        bool keyframe;
+        std::vector<std::pair<uint8_t, int32_t> > registers;
+        std::vector<std::pair<uint32_t, PagePtr> > pages;
+    };
+
+    void rebuildLast();
+
+    int interval_;
+    int keyframeEvery_;
+    std::vector<Checkpoint> checkpoints_;
+
+    // Register file and page table as of the newest checkpoint; deltas are
+    // taken against these.
+    RegisterFile lastRegisters_;
+    std::vector<PagePtr> lastPages_;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "intervals.hpp"
+#include "functional.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+uint64_t takeCheckpoints(const Processor& start, const std::vector<uint64_t>& positions, uint64_t limit,
+                         std::vector<ArchCheckpoint>& checkpoints, bool& ended) {
+    Processor cpu;
+    cpu.instMem = start.instMem;
+    cpu.regFile = start.regFile;
+    cpu.dataMem = start.dataMem;
+    cpu.pc = start.pc;
+
+    checkpoints.clear();
+    ended = false;
+    uint64_t executed = 0;
+    size_t next = 0;
+    for (;;) {
+        for (; next < positions.size() && positions[next] <= executed; next++) {
+            ArchCheckpoint checkpoint;
+            checkpoint.instructions = executed;
+            checkpoint.pc = cpu.pc;
+            checkpoint.regFile = cpu.regFile;
+            checkpoint.dataMem = cpu.dataMem;
+            checkpoints.push_back(checkpoint);
+        }
+        if (executed >= limit) break;
+        if (!executeInstruction(cpu)) {
+            ended = true;
+            break;
+        }
+        executed++;
+    }
+    return executed;
+}
+
+IntervalResult simulateInterval(const InstructionMemory& program, const ArchCheckpoint& from,
+                                const SimulatorConfig& config, const IntervalSettings& settings, uint64_t first,
+                                uint64_t end, uint64_t overlapEnd, bool drain) {
+    SimulatorConfig untraced = config;
+    untraced.traceEnabled = false;
+    Simulator sim(untraced);
+    Processor& cpu = sim.processor();
+    cpu.instMem = program;
+    sim.reset();
+    cpu.regFile = from.regFile;
+    cpu.dataMem = from.dataMem;
+    sim.redirect(from.pc);
+
+    // Runs until `count` instructions of the whole run have retired; false
+    // when the program halts or the cycle budget runs out first.
+    auto runTo = [&](uint64_t count) {
+        while (from.instructions + cpu.instructionsExecuted < count) {
+            if (sim.halted() || static_cast<uint64_t>(cpu.clockCycle) >= settings.maxCycles) return false;
+            sim.step();
+        }
+        return true;
+    };
+
+    IntervalResult result;
+    result.first = first;
+    bool reached = runTo(first);
+    SimulatorStats begin = sim.stats();
+    reached = reached && runTo(std::min(first + settings.overlap, end));
+    result.headCycles = cpu.clockCycle - begin.cycles;
+    if (drain) {
+        runTo(UINT64_MAX);
+        reached = reached && sim.halted();
+    } else {
+        reached = reached && runTo(end);
+    }
+    result.stats = sim.stats();
+    result.stats -= begin;
+
+    uint64_t endCycle = cpu.clockCycle;
+    reached = reached && runTo(overlapEnd);
+    result.overlapCycles = cpu.clockCycle - endCycle;
+    result.complete = reached;
+    return result;
+}
+
+IntervalRun simulateIntervals(const Processor& start, const SimulatorConfig& config, uint64_t instructions,
+                              const IntervalSettings& settings, unsigned threads) {
+    uint64_t length = std::max<uint64_t>(settings.length, 1);
+    std::vector<uint64_t> positions;
+    for (uint64_t first = 0; first < instructions; first += length) {
+        positions.push_back(first > settings.warmup ? first - settings.warmup : 0);
+    }
+
+    IntervalRun run;
+    std::vector<ArchCheckpoint> checkpoints;
+    run.instructions = takeCheckpoints(start, positions, instructions, checkpoints, run.ended);
+
+    size_t count = (run.instructions + length - 1) / length;
+    if (count == 0 && run.ended) count = 1;   // a program that ends at once still drains
+    run.intervals.resize(count);
+
+    WorkStealingPool pool(threads);
+    pool.run(count, [&](size_t i) {
+        uint64_t first = i * length;
+        uint64_t end = std::min(first + length, run.instructions);
+        uint64_t overlapEnd = i + 1 < count ? std::min(end + settings.overlap, std::min(end + length, run.instructions))
+                                            : end;
+        run.intervals[i] = simulateInterval(start.instMem, checkpoints[i], config, settings, first, end, overlapEnd,
+                                            run.ended && i + 1 == count);
+    });
+
+    for (size_t i = 0; i < count; i++) {
+        run.total += run.intervals[i].stats;
+        if (i > 0) {
+            int64_t difference = run.intervals[i].headCycles - run.intervals[i - 1].overlapCycles;
+            run.boundaryCycles += difference < 0 ? -difference : difference;
+        }
+    }
+    return run;
+}
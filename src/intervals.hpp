@@ -0,0 +1,80 @@
+#ifndef INTERVALS_HPP
+#define INTERVALS_HPP
+
+#include "processor.hpp"
+#include "simulator.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Architectural state after the first `instructions` instructions of a run.
+// Data memory pages are shared with the run and with other checkpoints until
+// someone writes them.
+struct ArchCheckpoint {
+    uint64_t instructions;
+    uint32_t pc;
+    RegisterFile regFile;
+    DataMemory dataMem;
+};
+
+// Executes architecturally from `start`'s registers, data memory and PC and
+// takes a checkpoint at each of the ascending instruction counts in
+// `positions`.  Stops after `limit` instructions or when the program ends;
+// returns the number executed, and sets `ended` when the program ended.
+uint64_t takeCheckpoints(const Processor& start, const std::vector<uint64_t>& positions, uint64_t limit,
+                         std::vector<ArchCheckpoint>& checkpoints, bool& ended);
+
+struct IntervalSettings {
+    uint64_t length;     // instructions per interval
+    uint64_t warmup;     // instructions simulated before each interval but not counted
+    uint64_t overlap;    // instructions simulated past each interval to estimate the error
+    uint64_t maxCycles;  // cycles per interval before it is abandoned
+
+    IntervalSettings() : length(100000), warmup(10000), overlap(1000), maxCycles(UINT64_MAX) {}
+};
+
+struct IntervalResult {
+    uint64_t first;          // instruction the interval starts at
+    SimulatorStats stats;    // the interval alone, without warm-up or overlap
+    uint64_t headCycles;     // cycles spent on its first `overlap` instructions
+    uint64_t overlapCycles;  // cycles spent on the next interval's first `overlap` instructions
+    bool complete;           // reached its end within maxCycles
+
+    IntervalResult() : first(0), headCycles(0), overlapCycles(0), complete(false) {}
+};
+
+struct IntervalRun {
+    std::vector<IntervalResult> intervals;
+    uint64_t instructions;   // covered by the functional pass
+    bool ended;              // the program ended within them
+    SimulatorStats total;    // the intervals merged
+
+    // Boundary effects: at every boundary the interval that runs on into the
+    // next one has a long history behind it, while the next one started
+    // `warmup` instructions earlier from cold.  Their cycles over the same
+    // `overlap` instructions differ by about what the cold start costs; the
+    // estimate is the sum of those differences relative to the total.
+    uint64_t boundaryCycles;
+    double cpiError() const { return total.cycles ? static_cast<double>(boundaryCycles) / total.cycles : 0.0; }
+
+    IntervalRun() : instructions(0), ended(false), boundaryCycles(0) {}
+};
+
+// Simulates instructions [first, end) of a run in detail from the checkpoint
+// at the start of their warm-up, then on to `overlapEnd`.  With `drain` they
+// are the last of a program that ends, and the run continues until the
+// pipeline empties.
+IntervalResult simulateInterval(const InstructionMemory& program, const ArchCheckpoint& from,
+                                const SimulatorConfig& config, const IntervalSettings& settings, uint64_t first,
+                                uint64_t end, uint64_t overlapEnd, bool drain);
+
+// Simulates the first `instructions` instructions from `start` (or up to the
+// end of the program) by slicing them into intervals.  A functional pass
+// checkpoints the start of every interval's warm-up, then the intervals are
+// simulated in detail on `threads` threads (0: one per core) and their
+// statistics merged.  The first interval starts from `start` itself and so
+// needs no warm-up; when the program ends, the last one includes the drain.
+IntervalRun simulateIntervals(const Processor& start, const SimulatorConfig& config, uint64_t instructions,
+                              const IntervalSettings& settings, unsigned threads);
+
+#endif
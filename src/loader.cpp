@@ -0,0 +1,33 @@
+#include "loader.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+bool loadProgram(std::istream& input, InstructionMemory& instMem) {
+    std::string line;
+
+    while (getline(input, line)) {
+        std::istringstream iss(line);
+        std::string hexcode, assemblycode;
+        if (!(iss >> hexcode)) continue;
+        std::getline(iss >> std::ws, assemblycode);
+
+        // Four hex digits or fewer is a 16-bit compressed instruction.
+        uint32_t machinecode = std::strtoul(hexcode.c_str(), nullptr, 16);
+        if (hexcode.size() <= 4) instMem.appendParcel(machinecode);
+        else instMem.appendWord(machinecode);
+    }
+
+    return true;
+}
+
+bool loadProgram(const std::string& filename, InstructionMemory& instMem) {
+    std::ifstream inputFile(filename);
+    if (!inputFile) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return false;
+    }
+
+    return loadProgram(inputFile, instMem);
+}
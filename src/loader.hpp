@@ -0,0 +1,14 @@
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include "processor.hpp"
+
+#include <string>
+
+// Reads a program listing where every line starts with a hex machine word,
+// optionally followed by its assembly text.  A code of at most four hex digits
+// is a 16-bit compressed instruction.
+bool loadProgram(const std::string& filename, InstructionMemory& instMem);
+bool loadProgram(std::istream& input, InstructionMemory& instMem);
+
+#endif
@@ -0,0 +1,98 @@
+#include "locality.hpp"
+
+#include <algorithm>
+
+ReuseDistanceAnalyzer::ReuseDistanceAnalyzer(uint32_t blockSize, uint64_t workingSetWindow)
+    : blockSize_(blockSize ? blockSize : 1), accesses_(0), time_(1), tree_(1025, 0),
+      windowSize_(workingSetWindow ? workingSetWindow : 1), window_(0), windowLength_(0),
+      windowDistinct_(0), windowsClosed_(0), workingSetTotal_(0), maxWorkingSet_(0) {}
+
+void ReuseDistanceAnalyzer::fenwickAdd(uint64_t position, int delta) {
+    for (; position < tree_.size(); position += position & (~position + 1)) tree_[position] += delta;
+}
+
+uint64_t ReuseDistanceAnalyzer::fenwickSum(uint64_t position) const {
+    uint64_t sum = 0;
+    for (; position > 0; position -= position & (~position + 1)) sum += tree_[position];
+    return sum;
+}
+
+// Renumbers the live blocks 1..n in order of their last access, which keeps
+// every distance intact, and gives the tree room for as many new accesses.
+void ReuseDistanceAnalyzer::compact() {
+    std::vector<std::pair<uint64_t, uint32_t>> live;
+    live.reserve(blocks_.size());
+    for (const auto& entry : blocks_) live.push_back({entry.second.lastTime, entry.first});
+    std::sort(live.begin(), live.end());
+
+    tree_.assign(std::max<size_t>(1024, 2 * live.size()) + 1, 0);
+    for (size_t i = 0; i < live.size(); i++) {
+        blocks_[live[i].second].lastTime = i + 1;
+        fenwickAdd(i + 1, 1);
+    }
+    time_ = live.size() + 1;
+}
+
+void ReuseDistanceAnalyzer::closeWindow() {
+    windowsClosed_++;
+    workingSetTotal_ += windowDistinct_;
+    maxWorkingSet_ = std::max(maxWorkingSet_, windowDistinct_);
+    window_++;
+    windowLength_ = 0;
+    windowDistinct_ = 0;
+}
+
+void ReuseDistanceAnalyzer::access(uint32_t address) {
+    if (windowLength_ == windowSize_) closeWindow();
+    if (time_ >= tree_.size()) compact();
+
+    uint32_t block = address / blockSize_;
+    auto it = blocks_.find(block);
+    if (it == blocks_.end()) {
+        it = blocks_.emplace(block, BlockState{0, window_}).first;
+        windowDistinct_++;
+    } else {
+        uint64_t distance = fenwickSum(time_ - 1) - fenwickSum(it->second.lastTime);
+        if (distance >= histogram_.size()) histogram_.resize(distance + 1, 0);
+        histogram_[distance]++;
+        fenwickAdd(it->second.lastTime, -1);
+        if (it->second.lastWindow != window_) windowDistinct_++;
+        it->second.lastWindow = window_;
+    }
+
+    fenwickAdd(time_, 1);
+    it->second.lastTime = time_++;
+    accesses_++;
+    windowLength_++;
+}
+
+double ReuseDistanceAnalyzer::missRatio(uint64_t cacheBlocks) const {
+    if (accesses_ == 0) return 0.0;
+    uint64_t misses = coldMisses();
+    for (uint64_t d = cacheBlocks; d < histogram_.size(); d++) misses += histogram_[d];
+    return static_cast<double>(misses) / accesses_;
+}
+
+double ReuseDistanceAnalyzer::averageWorkingSet() const {
+    // The window still being filled only counts when no window has closed.
+    if (windowsClosed_ == 0) return static_cast<double>(windowDistinct_);
+    return static_cast<double>(workingSetTotal_) / windowsClosed_;
+}
+
+void ReuseDistanceAnalyzer::writeReport(std::ostream& out, const std::string& name) const {
+    out << "[" << name << "] block size " << blockSize_ << " bytes\n";
+    out << "accesses: " << accesses_ << ", distinct blocks: " << distinctBlocks()
+        << ", cold misses: " << coldMisses() << "\n";
+    out << "working set per " << windowSize_ << " accesses: average " << averageWorkingSet()
+        << " blocks, max " << std::max(maxWorkingSet_, windowDistinct_) << " blocks\n";
+
+    // One row per LRU cache size up to the largest reuse distance seen; any
+    // larger cache only takes the cold misses.
+    out << "cache_blocks,cache_bytes,hits,miss_ratio\n";
+    uint64_t hits = 0;
+    for (uint64_t blocks = 1; blocks <= histogram_.size(); blocks++) {
+        hits += histogram_[blocks - 1];
+        double ratio = accesses_ ? static_cast<double>(accesses_ - hits) / accesses_ : 0.0;
+        out << blocks << "," << blocks * blockSize_ << "," << hits << "," << ratio << "\n";
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef LOCALITY_HPP
+#define LOCALITY_HPP
+
+#include "observer.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reuse-distance (LRU stack distance) analysis of an address stream.
+//
+// The reuse distance of an access is the number of distinct blocks touched
+// since the previous access to the same block.  A fully associative LRU cache
+// of C blocks hits exactly the accesses with distance < C, so one histogram
+// gives the miss ratio of every cache size at once.
+//
+// Distances are computed in O(log n) per access with a Fenwick tree over
+// access timestamps that holds a 1 at the latest access of every block: the
+// distance is the number of ones between the previous access and now.  The
+// tree is periodically compacted to the live blocks, so memory stays
+// proportional to the number of distinct blocks rather than the run length.
+class ReuseDistanceAnalyzer {
+public:
+    explicit ReuseDistanceAnalyzer(uint32_t blockSize = 4, uint64_t workingSetWindow = 1000);
+
+    void access(uint32_t address);
+
+    uint32_t blockSize() const { return blockSize_; }
+    uint64_t accesses() const { return accesses_; }
+    uint64_t coldMisses() const { return blocks_.size(); }
+    uint64_t distinctBlocks() const { return blocks_.size(); }
+
+    // histogram()[d] is the number of reuses at distance d.
+    const std::vector<uint64_t>& histogram() const { return histogram_; }
+
+    // Miss ratio of a fully associative LRU cache holding `cacheBlocks` blocks,
+    // cold misses included.
+    double missRatio(uint64_t cacheBlocks) const;
+
+    // Distinct blocks touched per window of `workingSetWindow` accesses.
+    double averageWorkingSet() const;
+    uint64_t maxWorkingSet() const { return maxWorkingSet_; }
+
+    void writeReport(std::ostream& out, const std::string& name) const;
+
+private:
+    struct BlockState {
+        uint64_t lastTime;
+        uint64_t lastWindow;
+    };
+
+    void fenwickAdd(uint64_t position, int delta);
+    uint64_t fenwickSum(uint64_t position) const;
+    void compact();
+    void closeWindow();
+
+    uint32_t blockSize_;
+    uint64_t accesses_;
+    uint64_t time_;
+    std::vector<int32_t> tree_;
+    std::unordered_map<uint32_t, BlockState> blocks_;
+    std::vector<uint64_t> histogram_;
+
+    uint64_t windowSize_, window_, windowLength_, windowDistinct_;
+    uint64_t windowsClosed_, workingSetTotal_, maxWorkingSet_;
+};
+
+// Feeds the data accesses of memoryStage and the fetches of
+// instructionFetchStage into separate reuse-distance analyzers.
+class LocalityAnalyzer : public PipelineObserver {
+public:
+    explicit LocalityAnalyzer(uint32_t blockSize = 4, uint64_t workingSetWindow = 1000)
+        : data_(blockSize, workingSetWindow), instructions_(blockSize, workingSetWindow) {}
+
+    void onInstructionFetch(Processor& cpu, uint32_t pc) override { instructions_.access(pc); }
+    void onMemoryAccess(Processor& cpu, const MemoryAccess& access) override { data_.access(access.address); }
+
+    const ReuseDistanceAnalyzer& data() const { return data_; }
+    const ReuseDistanceAnalyzer& instructions() const { return instructions_; }
+
+    void writeReport(std::ostream& out) const {
+        data_.writeReport(out, "data");
+        out << "\n";
+        instructions_.writeReport(out, "instruction");
+    }
+
+private:
+    ReuseDistanceAnalyzer data_;
+    ReuseDistanceAnalyzer instructions_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "memtrace.hpp"
+#include "byteorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+MemoryAccessLog::MemoryAccessLog(size_t capacity)
+    : records_(capacity ? capacity : 1), head_(0), count_(0), dropped_(0) {}
+
+void MemoryAccessLog::append(const MemoryAccess& access) {
+    records_[head_] = access;
+    head_ = (head_ + 1) % records_.size();
+    if (count_ < records_.size()) count_++;
+    else dropped_++;
+}
+
+void MemoryAccessLog::write(std::ostream& out) const {
+    out.write("RVML", 4);
+    putLE(out, 1, 4);
+    putLE(out, count_, 8);
+    putLE(out, dropped_, 8);
+
+    for (size_t i = 0; i < count_; i++) {
+        const MemoryAccess& access = at(i);
+        putLE(out, access.cycle, 8);
+        putLE(out, access.pc, 4);
+        putLE(out, access.address, 4);
+        putLE(out, static_cast<uint32_t>(access.value), 4);
+        putLE(out, access.size, 1);
+        putLE(out, access.isWrite ? 1 : 0, 1);
+        putLE(out, 0, 2);
+    }
+}
+
+bool readMemoryAccessLog(std::istream& in, std::vector<MemoryAccess>& accesses) {
+    unsigned char header[24];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+    if (std::memcmp(header, "RVML", 4) != 0 || getLE(header + 4, 4) != 1) return false;
+
+    uint64_t count = getLE(header + 8, 8);
+    accesses.clear();
+    accesses.reserve(std::min<uint64_t>(count, 1 << 20));
+
+    unsigned char record[24];
+    for (uint64_t i = 0; i < count; i++) {
+        if (!in.read(reinterpret_cast<char*>(record), sizeof(record))) return false;
+        MemoryAccess access;
+        access.cycle = getLE(record, 8);
+        access.pc = getLE(record + 8, 4);
+        access.address = getLE(record + 12, 4);
+        access.value = static_cast<int32_t>(getLE(record + 16, 4));
+        access.size = record[20];
+        access.isWrite = record[21] & 1;
+        accesses.push_back(access);
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef MEMTRACE_HPP
+#define MEMTRACE_HPP
+
+#include "observer.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Fixed-capacity ring buffer of data memory accesses.  Once full, the oldest
+// records are overwritten and counted as dropped, so a long run keeps the
+// most recent `capacity` accesses at a constant memory cost.
+//
+// Binary file layout (little-endian):
+//     char[4]  magic "RVML"
+//     uint32   version (1)
+//     uint64   record count
+//     uint64   dropped records
+//     records, oldest first, 24 bytes each:
+//         uint64 cycle, uint32 pc, uint32 address, uint32 value,
+//         uint8 size, uint8 flags (bit 0 = write), uint16 reserved
+class MemoryAccessLog : public PipelineObserver {
+public:
+    explicit MemoryAccessLog(size_t capacity = 1 << 20);
+
+    void append(const MemoryAccess& access);
+    void onMemoryAccess(Processor& cpu, const MemoryAccess& access) override { append(access); }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return records_.size(); }
+    uint64_t dropped() const { return dropped_; }
+    void clear() { head_ = 0; count_ = 0; dropped_ = 0; }
+
+    // i-th retained record, 0 being the oldest.
+    const MemoryAccess& at(size_t i) const {
+        return records_[(head_ + records_.size() - count_ + i) % records_.size()];
+    }
+
+    void write(std::ostream& out) const;
+
+private:
+    std::vector<MemoryAccess> records_;
+    size_t head_, count_;
+    uint64_t dropped_;
+};
+
+// Reads a file produced by MemoryAccessLog::write.
+bool readMemoryAccessLog(std::istream& in, std::vector<MemoryAccess>& accesses);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef OBSERVER_HPP
+#define OBSERVER_HPP
+
+#include <cstdint>
+
+struct Processor;
+struct MEM_WB_Register;
+struct Bubble;
+
+struct MemoryAccess {
+    uint64_t cycle;
+    uint32_t pc;
+    uint32_t address;
+    int32_t value;
+    uint8_t size;
+    bool isWrite;
+};
+
+// Datapath events the stages report for power models, each charged to the
+// instruction at the PC reported with it.
+enum ActivityEvent {
+    ACTIVITY_INSTRUCTION_FETCH,   // aligned word read from instruction memory
+    ACTIVITY_REGISTER_READ,
+    ACTIVITY_REGISTER_WRITE,
+    ACTIVITY_ALU,                 // one operation in EX
+    ACTIVITY_FORWARD,             // operand taken from a bypass path
+    ACTIVITY_DATA_READ,
+    ACTIVITY_DATA_WRITE,
+    ACTIVITY_LATCH_WRITE,         // pipeline latch or fetch queue entry loaded
+    ACTIVITY_EVENT_COUNT
+};
+
+// Hook interface for tools that watch the pipeline from the outside.
+// Observers are registered on Processor::observers; the stages only pay for
+// the notifications when at least one observer is attached.  An observer
+// that wants the run to pause sets Processor::stopRequested.
+class PipelineObserver {
+public:
+    virtual ~PipelineObserver() {}
+
+    // An instruction word read by instructionFetchStage, including fetches
+    // that are later squashed by a taken branch.
+    virtual void onInstructionFetch(Processor& cpu, uint32_t pc) {}
+
+    // A load or store performed by memoryStage.
+    virtual void onMemoryAccess(Processor& cpu, const MemoryAccess& access) {}
+
+    // A cycle in which instructionDecodeStage held the instruction in IF/ID
+    // because of a data hazard.
+    virtual void onStall(Processor& cpu) {}
+
+    // An instruction leaving the pipeline through writeBackStage.
+    virtual void onRetire(Processor& cpu, const MEM_WB_Register& retired) {}
+
+    // A WB slot without an instruction, with the cause of the bubble.
+    virtual void onBubble(Processor& cpu, const Bubble& bubble) {}
+
+    // Datapath activity of the instruction at `pc`; `opcode` is its Opcode.
+    virtual void onActivity(Processor& cpu, ActivityEvent event, uint32_t pc, int opcode) {}
+};
+
+#endif
@@ -0,0 +1,341 @@
+#include "options.hpp"
+#include "parsenumber.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Upper bounds on core options.  The fetch queue and loop buffer depths and
+// the predictor size each size an allocation, and the load latency is added
+// to the cycle count.
+static const long long kMaxQueueDepth = 1 << 16;
+static const long long kMaxLoadLatency = 1 << 16;
+static const long long kMaxPredictorEntries = 1 << 20;
+
+DriverOptions::DriverOptions(bool forwarding)
+    : cycles(0), memLogCapacity(1 << 20), logWatchpoints(false), localityBlock(4), depsWindow(64),
+      topDownRegion(32), bbvInterval(10000), loadStudy(false), decoupled(false) {
+    simulator.forwarding = forwarding;
+}
+
+std::string DriverOptions::outputPath() const {
+    if (!outputFile.empty()) return outputFile;
+    return program + (simulator.forwarding ? "_forward_out.txt" : "_noforward_out.txt");
+}
+
+static bool parseWatch(const std::string& spec, WatchpointSet& watchpoints) {
+    std::vector<std::string> fields;
+    std::stringstream ss(spec);
+    std::string field;
+    while (std::getline(ss, field, ':')) fields.push_back(field);
+    if (fields.empty() || fields.size() > 4) return false;
+
+    long long address, length = 4;
+    if (!parseNumber(fields[0], 0, UINT32_MAX, address)) return false;
+    if (fields.size() > 1 && !parseNumber(fields[1], 0, UINT32_MAX, length)) return false;
+
+    WatchpointSet::Kind kind = WatchpointSet::WATCH_WRITE;
+    if (fields.size() > 2) {
+        if (fields[2] == "r") kind = WatchpointSet::WATCH_READ;
+        else if (fields[2] == "w") kind = WatchpointSet::WATCH_WRITE;
+        else if (fields[2] == "a") kind = WatchpointSet::WATCH_ACCESS;
+        else return false;
+    }
+
+    WatchpointSet::Action action = WatchpointSet::STOP;
+    if (fields.size() > 3) {
+        if (fields[3] == "stop") action = WatchpointSet::STOP;
+        else if (fields[3] == "log") action = WatchpointSet::LOG;
+        else return false;
+    }
+
+    return watchpoints.add(address, length, kind, action);
+}
+
+// Parses a comma-separated list of fusion idiom names, or "all".
+static bool parseFusionIdioms(const std::string& spec, unsigned& idioms) {
+    std::stringstream ss(spec);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        int kind = FUSE_NONE + 1;
+        while (kind < FUSION_KIND_COUNT && name != fusionKindNames[kind]) kind++;
+        if (name == "all") idioms |= ((1u << FUSION_KIND_COUNT) - 1) & ~1u;
+        else if (kind < FUSION_KIND_COUNT) idioms |= 1u << kind;
+        else return false;
+    }
+    return true;
+}
+
+static bool parseSwitch(const std::string& text, bool& value) {
+    if (text.empty() || text == "on" || text == "true" || text == "1") value = true;
+    else if (text == "off" || text == "false" || text == "0") value = false;
+    else return false;
+    return true;
+}
+
+static const char* const kSwitches[] = {"early-load-address", "load-study", "address-predictor", "decoupled"};
+
+bool isSwitchOption(const std::string& name) {
+    for (const char* option : kSwitches) {
+        if (name == option) return true;
+    }
+    return false;
+}
+
+bool setOption(DriverOptions& options, const std::string& name, const std::string& value, std::string& error) {
+    CoreConfig& core = options.simulator.core;
+    long long number = 0;
+    bool enabled = false;
+
+    if (isSwitchOption(name)) {
+        if (!parseSwitch(value, enabled)) {
+            error = "bad value " + value + " for " + name;
+            return false;
+        }
+    } else if (value.empty()) {
+        error = "no value given for " + name;
+        return false;
+    }
+
+    if (name == "config") {
+        std::ifstream in(value);
+        if (!in) {
+            error = "cannot open config file " + value;
+            return false;
+        }
+        if (!loadOptions(in, options, error)) {
+            error = "in " + value + ": " + error;
+            return false;
+        }
+    } else if (name == "forwarding") {
+        if (!parseSwitch(value, enabled)) {
+            error = "bad value " + value + " for forwarding";
+            return false;
+        }
+        options.simulator.forwarding = enabled;
+    } else if (name == "data-memory") {
+        if (!parseNumber(value, number) || number < 0) {
+            error = "bad data memory size " + value;
+            return false;
+        }
+        options.simulator.dataMemorySize = number;
+    } else if (name == "output") {
+        options.outputFile = value;
+    } else if (name == "csv-trace") {
+        options.csvTraceFile = value;
+    } else if (name == "mem-log") {
+        options.memLogFile = value;
+    } else if (name == "mem-log-capacity") {
+        if (!parseNumber(value, number) || number < 1) {
+            error = "bad memory log capacity " + value;
+            return false;
+        }
+        options.memLogCapacity = number;
+    } else if (name == "watch") {
+        if (!parseWatch(value, options.watchpoints)) {
+            error = "bad watchpoint " + value;
+            return false;
+        }
+        options.logWatchpoints |= value.size() > 4 && value.compare(value.size() - 4, 4, ":log") == 0;
+    } else if (name == "locality") {
+        options.localityFile = value;
+    } else if (name == "locality-block") {
+        if (!parseNumber(value, number) || number < 1 || number > UINT32_MAX) {
+            error = "bad locality block size " + value;
+            return false;
+        }
+        options.localityBlock = number;
+    } else if (name == "cache-sweep") {
+        options.cacheSweepFile = value;
+    } else if (name == "cache") {
+        CacheConfig cache;
+        if (!parseCacheConfig(value, cache) || !options.cacheSweep.data().add(cache)) {
+            error = "bad cache configuration " + value;
+            return false;
+        }
+        options.cacheSweep.instructions().add(cache);
+    } else if (name == "bbv") {
+        options.bbvFile = value;
+    } else if (name == "bbv-interval") {
+        if (!parseNumber(value, number) || number < 1) {
+            error = "bad basic-block vector interval " + value;
+            return false;
+        }
+        options.bbvInterval = number;
+    } else if (name == "deps") {
+        options.depsFile = value;
+    } else if (name == "deps-window") {
+        if (!parseNumber(value, number) || number < 1) {
+            error = "bad dependency window " + value;
+            return false;
+        }
+        options.depsWindow = number;
+    } else if (name == "topdown") {
+        options.topDownFile = value;
+    } else if (name == "topdown-region") {
+        if (!parseNumber(value, number) || number < 1 || number > UINT32_MAX) {
+            error = "bad top-down region size " + value;
+            return false;
+        }
+        options.topDownRegion = number;
+    } else if (name == "energy") {
+        options.energyFile = value;
+    } else if (name == "energy-costs") {
+        std::ifstream in(value);
+        if (!in) {
+            error = "cannot open energy costs file " + value;
+            return false;
+        }
+        if (!options.energyCosts.load(in, error)) {
+            error = "in " + value + ": " + error;
+            return false;
+        }
+    } else if (name == "fetch-queue") {
+        if (!parseNumber(value, INT_MIN, kMaxQueueDepth, number)) {
+            error = "bad fetch queue depth " + value;
+            return false;
+        }
+        core.fetchQueueDepth = number;
+    } else if (name == "icache") {
+        // <size>:<line>:<miss latency>; the geometry is checked in validateOptions().
+        std::vector<std::string> fields;
+        std::stringstream ss(value);
+        std::string field;
+        while (std::getline(ss, field, ':')) fields.push_back(field);
+        long long size, line, latency;
+        if (fields.size() != 3 || !parseNumber(fields[0], size) || !parseNumber(fields[1], line) ||
+            !parseNumber(fields[2], latency) || size < 0 || size > UINT32_MAX || line < 0 || line > UINT32_MAX ||
+            latency < 0 || latency > INT_MAX) {
+            error = "bad instruction cache " + value;
+            return false;
+        }
+        core.icacheSize = size;
+        core.icacheLineSize = line;
+        core.icacheMissLatency = latency;
+    } else if (name == "load-latency") {
+        if (!parseNumber(value, INT_MIN, kMaxLoadLatency, number)) {
+            error = "bad load latency " + value;
+            return false;
+        }
+        core.loadUseLatency = number;
+    } else if (name == "early-load-address") {
+        core.earlyLoadAddress = enabled;
+    } else if (name == "load-study") {
+        options.loadStudy = enabled;
+    } else if (name == "load-predictor") {
+        if (value == "none") core.loadValuePrediction = LOAD_PREDICT_NONE;
+        else if (value == "last-value") core.loadValuePrediction = LOAD_PREDICT_LAST_VALUE;
+        else if (value == "stride") core.loadValuePrediction = LOAD_PREDICT_STRIDE;
+        else {
+            error = "unknown load predictor " + value;
+            return false;
+        }
+    } else if (name == "address-predictor") {
+        core.loadAddressPrediction = enabled;
+    } else if (name == "predictor-entries") {
+        if (!parseNumber(value, INT_MIN, kMaxPredictorEntries, number)) {
+            error = "bad load predictor size " + value;
+            return false;
+        }
+        core.loadPredictorEntries = number;
+    } else if (name == "fuse") {
+        if (!parseFusionIdioms(value, core.fusionIdioms)) {
+            error = "bad fusion idiom list " + value;
+            return false;
+        }
+    } else if (name == "loop-buffer") {
+        if (!parseNumber(value, INT_MIN, kMaxQueueDepth, number)) {
+            error = "bad loop buffer size " + value;
+            return false;
+        }
+        core.loopBufferSize = number;
+    } else if (name == "result-cache") {
+        options.resultCacheDir = value;
+    } else if (name == "record") {
+        options.recordFile = value;
+    } else if (name == "replay") {
+        options.replayFile = value;
+    } else if (name == "decoupled") {
+        options.decoupled = enabled;
+    } else {
+        error = "unknown option " + name;
+        return false;
+    }
+    return true;
+}
+
+bool loadOptions(std::istream& in, DriverOptions& options, std::string& error) {
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::string name, value, extra;
+        if (!(iss >> name)) continue;
+        iss >> value;
+        if (iss >> extra) {
+            error = "line " + std::to_string(number) + ": more than one value for " + name;
+            return false;
+        }
+        if (name == "config") {
+            error = "line " + std::to_string(number) + ": config files cannot include others";
+            return false;
+        }
+        if (!setOption(options, name, value, error)) {
+            error = "line " + std::to_string(number) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char *argv[], DriverOptions& options, std::string& error) {
+    long long cycles;
+    options.program = argv[1];
+    if (!parseNumber(argv[2], INT_MIN, INT_MAX, cycles)) {
+        error = std::string("bad cycle count ") + argv[2];
+        return false;
+    }
+    options.cycles = cycles;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            error = "unexpected argument " + arg;
+            return false;
+        }
+        std::string name = arg.substr(2);
+        std::string value;
+        if (!isSwitchOption(name)) {
+            if (i + 1 >= argc) {
+                error = "no value given for " + arg;
+                return false;
+            }
+            value = argv[++i];
+        }
+        if (!setOption(options, name, value, error)) return false;
+    }
+    return validateOptions(options, error);
+}
+
+bool validateOptions(const DriverOptions& options, std::string& error) {
+    const CoreConfig& core = options.simulator.core;
+    bool badIcache = core.icacheSize > 0 && (core.icacheLineSize < 4 || core.icacheSize < core.icacheLineSize ||
+                                             core.icacheMissLatency < 0);
+    error.clear();
+    if (options.cycles < 0) error = "the cycle count must not be negative";
+    else if (options.simulator.dataMemorySize < 4) error = "data memory must hold at least one word";
+    else if (core.fetchQueueDepth < 0) error = "the fetch queue depth must not be negative";
+    else if (badIcache) error = "bad instruction cache geometry";
+    else if (core.loadUseLatency < 1) error = "load latency must be at least 1";
+    else if (core.loadPredictorEntries < 1) error = "the load predictor needs at least one entry";
+    else if (core.loopBufferSize < 0) error = "the loop buffer size must not be negative";
+    else if (options.memLogCapacity < 1) error = "the memory log needs room for at least one access";
+    else if (options.localityBlock < 1 || options.topDownRegion < 1) error = "block and region sizes must be positive";
+    else if (options.depsWindow < 1) error = "the dependency window must hold at least one instruction";
+    else if (!options.recordFile.empty() && !options.replayFile.empty()) error = "cannot record while replaying";
+    else if (options.decoupled && !options.replayFile.empty()) error = "a replayed trace cannot run decoupled";
+    return error.empty();
+}
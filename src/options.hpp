@@ -0,0 +1,71 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "cachesim.hpp"
+#include "energy.hpp"
+#include "simulator.hpp"
+#include "watchpoint.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Everything a forward or noforward run is configured by: the machine, where
+// its traces go and which analyses run alongside it.  The binary only picks
+// the default forwarding mode.
+//
+// Options come from long flags on the command line and from config files
+// given with --config.  A config file holds one "<name> [<value>]" line per
+// option, named as the flag without its "--"; '#' starts a comment.  Both
+// sources go through setOption in the order they appear, so flags after
+// --config override the file.  A switch such as early-load-address takes no
+// value on the command line and an optional on/off in a file.
+struct DriverOptions {
+    std::string program;
+    int cycles;
+    SimulatorConfig simulator;
+
+    std::string outputFile;     // empty: "<program>_forward_out.txt" or "_noforward_out.txt"
+    std::string csvTraceFile;   // empty: no CSV trace
+
+    std::string memLogFile;
+    size_t memLogCapacity;
+    WatchpointSet watchpoints;
+    bool logWatchpoints;
+    std::string localityFile;
+    uint32_t localityBlock;
+    std::string cacheSweepFile;
+    CacheSweep cacheSweep;
+    std::string depsFile;
+    size_t depsWindow;
+    std::string topDownFile;
+    uint32_t topDownRegion;
+    std::string bbvFile;
+    uint64_t bbvInterval;
+    std::string energyFile;
+    EnergyCosts energyCosts;
+    bool loadStudy;
+    std::string resultCacheDir;
+    std::string recordFile;   // execution trace written after the run
+    std::string replayFile;   // execution trace replayed instead of running the program
+    bool decoupled;           // functional execution on a thread of its own
+
+    explicit DriverOptions(bool forwarding);
+
+    std::string outputPath() const;
+};
+
+// Whether `name` is a switch rather than an option that needs a value.
+bool isSwitchOption(const std::string& name);
+
+bool setOption(DriverOptions& options, const std::string& name, const std::string& value, std::string& error);
+bool loadOptions(std::istream& in, DriverOptions& options, std::string& error);
+
+// Parses "<program> <cycles> [options]", then validates the result.
+bool parseOptions(int argc, char *argv[], DriverOptions& options, std::string& error);
+
+// Checks the option combination once, before the machine is built.
+bool validateOptions(const DriverOptions& options, std::string& error);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PARSENUMBER_HPP
+#define PARSENUMBER_HPP
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+// Integers on command lines, option files and specs: decimal, or hex with a
+// 0x prefix.  The whole text must be the number, so "junk" or "4k" is
+// rejected rather than read as 0 or 4.
+inline bool parseNumber(const std::string& text, long long& value) {
+    char* end;
+    errno = 0;
+    value = std::strtoll(text.c_str(), &end, 0);
+    return !text.empty() && *end == '\0' && errno != ERANGE;
+}
+
+// As above, also requiring min <= value <= max so that the caller can store
+// it in a narrower type without wrapping.
+inline bool parseNumber(const std::string& text, long long min, long long max, long long& value) {
+    return parseNumber(text, value) && value >= min && value <= max;
+}
+
+#endif
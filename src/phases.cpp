@@ -0,0 +1,218 @@
+#include "phases.hpp"
+#include "functional.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <random>
+
+BasicBlockProfile::BasicBlockProfile(uint64_t interval)
+    : interval_(std::max<uint64_t>(interval, 1)), retired_(0), blockOpen_(false), block_(0) {}
+
+void BasicBlockProfile::onRetire(Processor& cpu, const MEM_WB_Register& retired) {
+    const Instruction& inst = retired.instruction;
+    uint32_t pc = retired.pc;
+
+    // The first half of a fused pair is never a branch or jump.
+    if (inst.fusion != FUSE_NONE) {
+        retire(pc, false);
+        pc += inst.length;
+    }
+
+    bool transfer = inst.format == B_TYPE || inst.format == J_TYPE || inst.opcode == JALR;
+    retire(pc, transfer && !retired.control.branch && !retired.control.jump);
+}
+
+void BasicBlockProfile::retire(uint32_t pc, bool taken) {
+    if (!blockOpen_) {
+        auto inserted = blockIds_.insert(std::make_pair(pc, static_cast<uint32_t>(blockStarts_.size())));
+        if (inserted.second) blockStarts_.push_back(pc);
+        block_ = inserted.first->second;
+        blockOpen_ = true;
+    }
+    counts_[block_]++;
+    if (taken) blockOpen_ = false;
+    if (++retired_ == interval_) closeInterval();
+}
+
+void BasicBlockProfile::finish() {
+    if (retired_ > 0) closeInterval();
+}
+
+void BasicBlockProfile::closeInterval() {
+    BasicBlockVector vector(counts_.begin(), counts_.end());
+    std::sort(vector.begin(), vector.end());
+    vectors_.push_back(vector);
+    counts_.clear();
+    retired_ = 0;
+}
+
+uint64_t BasicBlockProfile::instructions(size_t i) const {
+    uint64_t total = 0;
+    for (const auto& entry : vectors_[i]) total += entry.second;
+    return total;
+}
+
+void BasicBlockProfile::write(std::ostream& out) const {
+    for (const BasicBlockVector& vector : vectors_) {
+        out << "T";
+        for (const auto& entry : vector) out << ":" << entry.first + 1 << ":" << entry.second << " ";
+        out << "\n";
+    }
+}
+
+uint64_t profileBasicBlocks(const Processor& start, uint64_t instructions, BasicBlockProfile& profile) {
+    Processor cpu;
+    cpu.instMem = start.instMem;
+    cpu.regFile = start.regFile;
+    cpu.dataMem = start.dataMem;
+    cpu.pc = start.pc;
+
+    uint64_t executed = 0;
+    TraceRecord record;
+    while (executed < instructions && executeInstruction(cpu, &record)) {
+        profile.retire(record.pc, record.taken());
+        executed++;
+    }
+    profile.finish();
+    return executed;
+}
+
+// Dimensions of the random projection; SimPoint uses 15.
+static const int kDimensions = 15;
+typedef std::array<double, kDimensions> Projected;
+
+static double distance(const Projected& a, const Projected& b) {
+    double sum = 0.0;
+    for (int d = 0; d < kDimensions; d++) sum += (a[d] - b[d]) * (a[d] - b[d]);
+    return sum;
+}
+
+// One k-means run with k-means++ seeding.  Returns the sum of squared
+// distances to the assigned centres.
+static double cluster(const std::vector<Projected>& points, size_t k, std::mt19937_64& random,
+                      std::vector<size_t>& assignment, std::vector<Projected>& centres) {
+    size_t n = points.size();
+    centres.assign(1, points[std::uniform_int_distribution<size_t>(0, n - 1)(random)]);
+    std::vector<double> nearest(n);
+    while (centres.size() < k) {
+        double total = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            nearest[i] = std::numeric_limits<double>::max();
+            for (const Projected& centre : centres) nearest[i] = std::min(nearest[i], distance(points[i], centre));
+            total += nearest[i];
+        }
+        size_t next = 0;
+        if (total > 0.0) {
+            double draw = std::uniform_real_distribution<double>(0.0, total)(random);
+            while (next + 1 < n && draw >= nearest[next]) draw -= nearest[next++];
+        } else {
+            next = std::uniform_int_distribution<size_t>(0, n - 1)(random);
+        }
+        centres.push_back(points[next]);
+    }
+
+    assignment.assign(n, k);
+    for (int iteration = 0; iteration < 100; iteration++) {
+        bool changed = false;
+        for (size_t i = 0; i < n; i++) {
+            size_t best = 0;
+            for (size_t c = 1; c < k; c++) {
+                if (distance(points[i], centres[c]) < distance(points[i], centres[best])) best = c;
+            }
+            if (assignment[i] != best) {
+                assignment[i] = best;
+                changed = true;
+            }
+        }
+        if (!changed) break;
+
+        // An empty cluster keeps its old centre.
+        std::vector<Projected> sums(k, Projected());
+        std::vector<size_t> sizes(k, 0);
+        for (size_t i = 0; i < n; i++) {
+            for (int d = 0; d < kDimensions; d++) sums[assignment[i]][d] += points[i][d];
+            sizes[assignment[i]]++;
+        }
+        for (size_t c = 0; c < k; c++) {
+            if (!sizes[c]) continue;
+            for (int d = 0; d < kDimensions; d++) centres[c][d] = sums[c][d] / sizes[c];
+        }
+    }
+
+    double spread = 0.0;
+    for (size_t i = 0; i < n; i++) spread += distance(points[i], centres[assignment[i]]);
+    return spread;
+}
+
+std::vector<SimulationPoint> chooseSimulationPoints(const BasicBlockProfile& profile, size_t phases, uint64_t seed,
+                                                    int restarts, std::vector<size_t>* phaseOf) {
+    const std::vector<BasicBlockVector>& vectors = profile.vectors();
+    size_t n = vectors.size();
+    std::vector<SimulationPoint> points;
+    if (n == 0 || phases == 0) return points;
+
+    std::mt19937_64 random(seed);
+    std::vector<Projected> projection(profile.blocks());
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    for (Projected& row : projection) {
+        for (int d = 0; d < kDimensions; d++) row[d] = unit(random);
+    }
+
+    std::vector<Projected> projected(n, Projected());
+    uint64_t totalInstructions = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t instructions = profile.instructions(i);
+        totalInstructions += instructions;
+        for (const auto& entry : vectors[i]) {
+            double share = static_cast<double>(entry.second) / instructions;
+            for (int d = 0; d < kDimensions; d++) projected[i][d] += share * projection[entry.first][d];
+        }
+    }
+
+    size_t k = std::min(phases, n);
+    double bestSpread = std::numeric_limits<double>::max();
+    std::vector<size_t> best, assignment;
+    std::vector<Projected> bestCentres, centres;
+    for (int run = 0; run < std::max(restarts, 1); run++) {
+        double spread = cluster(projected, k, random, assignment, centres);
+        if (spread < bestSpread) {
+            bestSpread = spread;
+            best = assignment;
+            bestCentres = centres;
+        }
+    }
+
+    // The member nearest each centre represents its phase.
+    std::vector<size_t> representative(k, n);
+    std::vector<SimulationPoint> byCluster(k, SimulationPoint());
+    for (size_t i = 0; i < n; i++) {
+        size_t c = best[i];
+        if (representative[c] == n ||
+            distance(projected[i], bestCentres[c]) < distance(projected[representative[c]], bestCentres[c])) {
+            representative[c] = i;
+        }
+        byCluster[c].members++;
+        byCluster[c].weight += static_cast<double>(profile.instructions(i)) / totalInstructions;
+    }
+
+    std::vector<size_t> order;
+    for (size_t c = 0; c < k; c++) {
+        if (representative[c] == n) continue;
+        byCluster[c].interval = representative[c];
+        order.push_back(c);
+    }
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return representative[a] < representative[b]; });
+
+    std::vector<size_t> phaseNumber(k, 0);
+    for (size_t p = 0; p < order.size(); p++) {
+        points.push_back(byCluster[order[p]]);
+        phaseNumber[order[p]] = p;
+    }
+    if (phaseOf) {
+        phaseOf->resize(n);
+        for (size_t i = 0; i < n; i++) (*phaseOf)[i] = phaseNumber[best[i]];
+    }
+    return points;
+}
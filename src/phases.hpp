@@ -0,0 +1,86 @@
+#ifndef PHASES_HPP
+#define PHASES_HPP
+
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// (block id, instructions retired in the block), ascending by id.
+typedef std::vector<std::pair<uint32_t, uint64_t> > BasicBlockVector;
+
+// Basic-block vectors for phase analysis.  The run is cut into intervals of
+// `interval` retired instructions, and an interval's vector counts the
+// instructions each block retired in it.  A block starts where a taken branch
+// or jump lands and runs to the next taken one, as ID resolved them: ID clears
+// the branch and jump signals of a transfer it takes, and those travel with
+// the instruction to retirement.  Blocks are numbered from 0 in the order
+// they are first entered.
+//
+// It watches a detailed run as an observer, or is fed by a functional pass
+// through retire().
+class BasicBlockProfile : public PipelineObserver {
+public:
+    explicit BasicBlockProfile(uint64_t interval);
+
+    void onRetire(Processor& cpu, const MEM_WB_Register& retired) override;
+
+    // One retired instruction at `pc`; `taken` when it transferred control.
+    void retire(uint32_t pc, bool taken);
+
+    // Closes the last interval if it is partly filled.
+    void finish();
+
+    uint64_t interval() const { return interval_; }
+    size_t blocks() const { return blockStarts_.size(); }
+    uint32_t blockStart(uint32_t block) const { return blockStarts_[block]; }
+    const std::vector<BasicBlockVector>& vectors() const { return vectors_; }
+
+    // Instructions in interval `i`: `interval` except perhaps for the last.
+    uint64_t instructions(size_t i) const;
+
+    // SimPoint's frequency vector format: one "T:<block>:<count> ..." line
+    // per interval, with blocks numbered from 1.
+    void write(std::ostream& out) const;
+
+private:
+    void closeInterval();
+
+    uint64_t interval_;
+    uint64_t retired_;                    // in the open interval
+    bool blockOpen_;
+    uint32_t block_;
+    std::unordered_map<uint32_t, uint32_t> blockIds_;   // by start PC
+    std::vector<uint32_t> blockStarts_;
+    std::unordered_map<uint32_t, uint64_t> counts_;    // of the open interval
+    std::vector<BasicBlockVector> vectors_;
+};
+
+// Profiles the first `instructions` instructions from `start`'s registers,
+// data memory and PC, or up to the end of the program, by executing them
+// architecturally.  Returns the number executed.
+uint64_t profileBasicBlocks(const Processor& start, uint64_t instructions, BasicBlockProfile& profile);
+
+struct SimulationPoint {
+    size_t interval;    // representative of its phase
+    size_t members;     // intervals in the phase
+    double weight;      // the phase's share of the profiled instructions
+
+    SimulationPoint() : interval(0), members(0), weight(0.0) {}
+};
+
+// Groups the intervals into at most `phases` phases with k-means and picks
+// the interval nearest each phase's centre.  Vectors are normalised to
+// fractions of their interval and randomly projected to a few dimensions
+// first, as SimPoint does.  k-means++ seeding is restarted `restarts` times
+// from `seed` and the tightest clustering kept.  `phaseOf`, when given,
+// receives each interval's phase number.  Points are in interval order.
+std::vector<SimulationPoint> chooseSimulationPoints(const BasicBlockProfile& profile, size_t phases, uint64_t seed,
+                                                    int restarts = 5, std::vector<size_t>* phaseOf = nullptr);
+
+#endif
@@ -0,0 +1,807 @@
+#include "pipeline.hpp"
+#include "observer.hpp"
+
+#include <iostream>
+
+static void notifyActivity(Processor& cpu, ActivityEvent event, uint32_t pc, Opcode opcode) {
+    for (PipelineObserver* observer : cpu.observers) observer->onActivity(cpu, event, pc, opcode);
+}
+
+// Register read in ID.  Stages run from WB backwards, so an instruction that
+// is in MEM/WB while its consumer decodes only reaches the register file in
+// the next cycle, and may already have left MEM/WB by the time the consumer
+// executes.  With forwarding the value is bypassed here instead.
+static int32_t readRegisterOperand(const Processor& cpu, int reg, bool isForwarding) {
+    if (isForwarding && reg > 0 && cpu.memWb.valid && cpu.memWb.control.regWrite &&
+        cpu.memWb.instruction.rd == reg) {
+        return cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+    }
+    return cpu.regFile.read(reg);
+}
+
+// The value an instruction in EX/MEM forwards.  A load only has one there
+// when its value was predicted or it accessed memory in EX; otherwise the
+// hazard unit keeps its consumers from reaching EX while it is in EX/MEM.
+static int32_t exMemResult(const Processor& cpu) {
+    if (!cpu.exMem.control.memToReg) return cpu.exMem.aluResult.result;
+    return cpu.exMem.valuePredicted ? cpu.exMem.predictedValue : cpu.exMem.loadData;
+}
+
+int32_t readDataMemory(const DataMemory& memory, Opcode opcode, uint32_t address) {
+    switch (opcode) {
+        case LB: {
+            int32_t value = memory.read(address, 1);
+            return (value & 0x80) ? (value | 0xFFFFFF00) : value;
+        }
+        case LH: {
+            int32_t value = memory.read(address, 2);
+            return (value & 0x8000) ? (value | 0xFFFF0000) : value;
+        }
+        case LW: return memory.read(address, 4);
+        case LBU: return memory.read(address, 1) & 0xFF;
+        case LHU: return memory.read(address, 2) & 0xFFFF;
+        default: return 0;
+    }
+}
+
+void writeDataMemory(DataMemory& memory, Opcode opcode, uint32_t address, int32_t value) {
+    switch (opcode) {
+        case SB: memory.write(address, value, 1); break;
+        case SH: memory.write(address, value, 2); break;
+        case SW: memory.write(address, value, 4); break;
+        default: break;
+    }
+}
+
+int32_t aluResult(const Instruction& inst, uint32_t pc, int32_t aluInput1, int32_t aluInput2, int32_t rs2Value) {
+    // Fused ops that do more than their base opcode.
+    switch (inst.fusion) {
+        case FUSE_INDEXED_LOAD:
+            return aluInput1 + rs2Value + aluInput2;
+        case FUSE_SHIFT_ADD:
+            return (aluInput1 << inst.immediate) + aluInput2;
+        case FUSE_ZERO_EXTEND:
+            return static_cast<uint32_t>(aluInput1 << (aluInput2 & 0x1F)) >> ((aluInput2 >> 5) & 0x1F);
+        default:
+            break;
+    }
+
+    switch (inst.opcode) {
+        case ADD: case ADDI: case LB: case LH: case LW: case LBU: case LHU: case SB: case SH: case SW:
+        case JALR:
+            return aluInput1 + aluInput2;
+        case SUB:
+            return aluInput1 - aluInput2;
+        case AND: case ANDI:
+            return aluInput1 & aluInput2;
+        case OR: case ORI:
+            return aluInput1 | aluInput2;
+        case XOR: case XORI:
+            return aluInput1 ^ aluInput2;
+        case SLL: case SLLI:
+            return aluInput1 << (aluInput2 & 0x1F);
+        case SRL: case SRLI:
+            return static_cast<uint32_t>(aluInput1) >> (aluInput2 & 0x1F);
+        case SRA: case SRAI:
+            return aluInput1 >> (aluInput2 & 0x1F);
+        case SLT: case SLTI: case BLT: case BGE:
+            return (aluInput1 < aluInput2) ? 1 : 0;
+        case SLTU: case SLTIU: case BLTU: case BGEU:
+            return (static_cast<uint32_t>(aluInput1) < static_cast<uint32_t>(aluInput2)) ? 1 : 0;
+        case BEQ:
+            return (aluInput1 == aluInput2) ? 1 : 0;
+        case BNE:
+            return (aluInput1 != aluInput2) ? 1 : 0;
+        case JAL:
+            return pc + inst.length;  // Return address
+        case LUI:
+            return inst.immediate;  // Load upper immediate
+        case AUIPC:
+            return pc + inst.immediate;  // Add PC and upper immediate
+        default:
+            return 0;
+    }
+}
+
+bool resolveBranch(const Instruction& inst, uint32_t pc, int32_t rs1Value, int32_t rs2Value, uint32_t& target) {
+    // For JAL (J-type), always taken
+    if (inst.format == J_TYPE) {
+        target = pc + inst.immediate;
+        return true;
+    }
+    // For JALR, always taken with calculated target
+    if (inst.opcode == JALR) {
+        target = (rs1Value + inst.immediate) & ~1; // Clear LSB
+        return true;
+    }
+    // For conditional branches (B-type), evaluate condition
+    if (inst.format != B_TYPE) return false;
+
+    bool conditionMet = false;
+    switch (inst.opcode) {
+        case BEQ: conditionMet = (rs1Value == rs2Value); break;
+        case BNE: conditionMet = (rs1Value != rs2Value); break;
+        case BLT: conditionMet = (rs1Value < rs2Value); break;
+        case BGE: conditionMet = (rs1Value >= rs2Value); break;
+        case BLTU: conditionMet = (static_cast<uint32_t>(rs1Value) < static_cast<uint32_t>(rs2Value)); break;
+        case BGEU: conditionMet = (static_cast<uint32_t>(rs1Value) >= static_cast<uint32_t>(rs2Value)); break;
+        default: conditionMet = false;
+    }
+
+    // --------------------------------------------------------------------------------------
+    // taking default condition not met
+    // --------------------------------------------------------------------------------------
+    // conditionMet = false;
+
+    if (conditionMet) target = pc + inst.immediate;
+    return conditionMet;
+}
+
+// The record holding the memory access of the instruction in `latch` while
+// a trace is replayed; for a fused pair that is its second instruction.
+static const TraceRecord& replayRecord(const Processor& cpu, const ID_EX_Register& latch) {
+    return *cpu.replaySource->record(latch.replayIndex + (latch.instruction.fusion != FUSE_NONE ? 1 : 0));
+}
+
+// Sends fetch to `target` and squashes everything fetched after the
+// instruction at `causePc` (a taken branch, or a load whose value was
+// mispredicted).
+static void redirectFetch(Processor& cpu, uint32_t target, uint32_t causePc, BubbleCause cause) {
+    cpu.pc = target;
+    cpu.fetchBuffer.flush(target);
+    cpu.fetchQueue.clear();
+    cpu.loopBuffer.stop();
+    cpu.ifId.valid = false;
+    cpu.ifId.bubble = Bubble(cause, causePc);
+}
+
+// Consults the load predictor for the load ID has just passed on.  A value
+// prediction is used as is; an address prediction reads memory at the
+// predicted address now, which may miss an older store still in flight, but
+// MEM catches that like any other wrong value.  A replayed load has no memory
+// to read, so its address prediction is taken to be right exactly when it
+// names the recorded address.
+static void predictLoad(Processor& cpu, bool isForwarding) {
+    ID_EX_Register& load = cpu.idEx;
+    load.valuePredicted = false;
+    if (!isForwarding || !cpu.loadPredictor.enabled() || !load.control.memRead || load.instruction.rd <= 0 ||
+        load.instruction.fusion != FUSE_NONE) {
+        return;
+    }
+
+    uint32_t address;
+    if (cpu.core.loadValuePrediction != LOAD_PREDICT_NONE &&
+        cpu.loadPredictor.predictValue(load.pc, load.predictedValue)) {
+        cpu.loadValuePredictions++;
+    } else if (cpu.core.loadAddressPrediction && cpu.loadPredictor.predictAddress(load.pc, address)) {
+        if (cpu.replaySource) {
+            const TraceRecord& record = replayRecord(cpu, load);
+            load.predictedValue = address == record.address ? record.value : ~record.value;
+        } else {
+            load.predictedValue = readDataMemory(cpu.dataMem, load.instruction.opcode, address);
+        }
+        notifyActivity(cpu, ACTIVITY_DATA_READ, load.pc, load.instruction.opcode);
+        cpu.loadAddressPredictions++;
+    } else {
+        return;
+    }
+
+    load.valuePredicted = true;
+    cpu.hazardUnit.markReady(load.instruction.rd);
+}
+
+// Trains the load predictor with the load in MEM.  When its value was
+// predicted wrongly, everything behind it may have used the prediction and
+// is squashed before EX runs this cycle; fetch restarts after the load, and
+// so does the replayed trace.
+static void checkLoadPrediction(Processor& cpu, uint32_t address) {
+    const EX_MEM_Register& load = cpu.exMem;
+    if (load.instruction.fusion == FUSE_NONE) cpu.loadPredictor.train(load.pc, address, cpu.memWb.readData);
+    if (!load.valuePredicted || cpu.memWb.readData == load.predictedValue) return;
+
+    cpu.loadMispredicts++;
+    cpu.idEx.valid = false;
+    cpu.idEx.bubble = Bubble(BUBBLE_VALUE_MISPREDICT, load.pc);
+    cpu.hazardUnit.clear();
+    redirectFetch(cpu, load.pc + load.instruction.length, load.pc, BUBBLE_VALUE_MISPREDICT);
+    if (cpu.replaySource) {
+        cpu.replayCursor = load.replayIndex + 1;
+        cpu.replayEnded = false;
+    }
+}
+
+// Reads the aligned word holding the next parcel the fetch buffer needs, if
+// the buffer has room for the parcels of that word and the instruction cache
+// has the line.
+static void fetchWord(Processor& cpu) {
+    FetchBuffer& buffer = cpu.fetchBuffer;
+    uint32_t address = buffer.pc + 2 * buffer.count;
+    if (!cpu.instMem.contains(address)) return;
+
+    int parcels = (address & 2) ? 1 : 2;
+    if (buffer.count + parcels > FetchBuffer::kCapacity) return;
+
+    if (cpu.icache.enabled()) {
+        if (cpu.clockCycle < cpu.icacheReadyCycle) return;
+        cpu.icacheAccesses++;
+        if (!cpu.icache.access(address)) {
+            cpu.icacheMisses++;
+            cpu.icacheReadyCycle = cpu.clockCycle + cpu.core.icacheMissLatency;
+            return;
+        }
+    }
+
+    for (int i = 0; i < parcels && cpu.instMem.contains(address); i++, address += 2) {
+        buffer.parcels[buffer.count++] = cpu.instMem.readParcel(address);
+    }
+    cpu.fetchWords++;
+    notifyActivity(cpu, ACTIVITY_INSTRUCTION_FETCH, buffer.pc, INVALID);
+}
+
+// Moves the next whole instruction out of the fetch buffer into `fetched`,
+// decoding it in place, and advances the fetch PC.
+static bool fetchInstruction(Processor& cpu, IF_ID_Register& fetched) {
+    // The PC moved under the buffer (a debugger write or a redirect).
+    if (cpu.fetchBuffer.pc != cpu.pc) cpu.fetchBuffer.flush(cpu.pc);
+
+    fetchWord(cpu);
+    if (!cpu.fetchBuffer.hasInstruction()) return false;
+
+    uint32_t instruction = cpu.fetchBuffer.parcels[0];
+    if (!InstructionMemory::isCompressed(instruction)) {
+        instruction |= static_cast<uint32_t>(cpu.fetchBuffer.parcels[1]) << 16;
+    }
+    cpu.trackStage(cpu.pc, "IF");
+
+    for (PipelineObserver* observer : cpu.observers) observer->onInstructionFetch(cpu, cpu.pc);
+
+    fetched.pc = cpu.pc;
+    cpu.decodeInstruction(instruction, fetched.instruction);
+    fetched.valid = true;
+
+    int length = fetched.instruction.length;
+    cpu.instructionsFetched++;
+    if (length == 2) cpu.compressedFetched++;
+    FetchBuffer& buffer = cpu.fetchBuffer;
+    buffer.count -= length / 2;
+    for (int i = 0; i < buffer.count; i++) buffer.parcels[i] = buffer.parcels[i + length / 2];
+    buffer.pc += length;
+    cpu.pc += length;
+    return true;
+}
+
+// Hands the next instruction to `fetched`: from the loop buffer while it is
+// replaying, which skips instruction memory and the decoder, and from the
+// fetch unit otherwise.
+static bool nextInstruction(Processor& cpu, IF_ID_Register& fetched) {
+    LoopBuffer& loop = cpu.loopBuffer;
+    if (loop.replaying()) {
+        fetched = loop.replay();
+        cpu.trackStage(fetched.pc, "IF");
+        cpu.pc = loop.nextPc();
+        cpu.loopBufferReplays++;
+        return true;
+    }
+
+    if (!fetchInstruction(cpu, fetched)) return false;
+    if (loop.enabled()) {
+        loop.capture(fetched);
+        if (loop.replaying()) cpu.pc = loop.nextPc();
+    }
+    return true;
+}
+
+template <bool isForwarding>
+void instructionFetchStage(Processor& cpu, bool& stall) {
+    size_t depth = cpu.core.fetchQueueDepth;
+
+    if (depth == 0) {
+        if (stall) return;
+        if (!nextInstruction(cpu, cpu.ifId)) {
+            cpu.ifId.valid = false;
+            cpu.ifId.bubble = Bubble(BUBBLE_FETCH_STARVED, cpu.pc);
+            cpu.fetchStarvedCycles++;
+            return;
+        }
+        notifyActivity(cpu, ACTIVITY_LATCH_WRITE, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+    } else {
+        // The fetch unit keeps filling the queue while ID is stalled.
+        std::deque<IF_ID_Register>& queue = cpu.fetchQueue;
+        if (queue.size() < depth) {
+            IF_ID_Register fetched;
+            if (nextInstruction(cpu, fetched)) {
+                queue.push_back(fetched);
+                notifyActivity(cpu, ACTIVITY_LATCH_WRITE, fetched.pc, fetched.instruction.opcode);
+            }
+        }
+        cpu.fetchQueueOccupancy[queue.size()]++;
+
+        if (stall) return;
+        if (queue.empty()) {
+            cpu.ifId.valid = false;
+            cpu.ifId.bubble = Bubble(BUBBLE_FETCH_STARVED, cpu.pc);
+            cpu.fetchStarvedCycles++;
+            return;
+        }
+        cpu.ifId = queue.front();
+        queue.pop_front();
+        notifyActivity(cpu, ACTIVITY_LATCH_WRITE, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+    }
+
+    IF_ID_Register tempIfId = cpu.ifId;
+    bool ifStall = cpu.hazardUnit.detectHazardF(tempIfId, cpu.idEx, cpu.exMem, cpu.memWb, isForwarding,
+                                                cpu.clockCycle, true);
+    if (ifStall) stall = true;
+}
+
+// Folds the instruction behind IF/ID into it when the two form an enabled
+// fusion idiom.  The partner is taken from the head of the fetch queue, or
+// fetched now when the queue is empty.
+static void fuseWithNext(Processor& cpu) {
+    IF_ID_Register& first = cpu.ifId;
+    if (first.instruction.fusion != FUSE_NONE) return;
+
+    IF_ID_Register next;
+    bool fromQueue = !cpu.fetchQueue.empty();
+    if (fromQueue) {
+        next = cpu.fetchQueue.front();
+    } else {
+        if (!cpu.instMem.contains(cpu.pc)) return;
+        next.pc = cpu.pc;
+        cpu.decodeInstruction(cpu.instMem.readInstruction(cpu.pc), next.instruction);
+    }
+
+    Instruction fused;
+    if (next.pc != first.pc + first.instruction.length ||
+        !cpu.fuseInstructions(first.instruction, next.instruction, fused)) {
+        return;
+    }
+
+    if (fromQueue) cpu.fetchQueue.pop_front();
+    else if (!nextInstruction(cpu, next)) return;
+
+    first.instruction = fused;
+    cpu.fusedPairs[fused.fusion]++;
+}
+
+// Whether the replayed trace has the records of the instruction in IF/ID.
+// When it has run out, or holds another PC because the program or its
+// initial state differ from the recording, the instruction stays in IF/ID
+// and the pipeline drains.
+static bool replayHasRecords(Processor& cpu) {
+    const TraceRecord* record = cpu.replaySource->record(cpu.replayCursor);
+    bool fused = cpu.ifId.instruction.fusion != FUSE_NONE;
+    if (record && record->pc != cpu.ifId.pc) {
+        if (!cpu.replayDiverged) cpu.stopRequested = true;
+        cpu.replayDiverged = true;
+    } else if (record && (!fused || cpu.replaySource->record(cpu.replayCursor + 1))) {
+        return true;
+    }
+    cpu.replayEnded = true;
+    return false;
+}
+
+template <bool isForwarding>
+void instructionDecodeStage(Processor& cpu, bool& stall, bool& branchTaken, uint32_t& branchTarget) {
+    branchTaken = false;
+    branchTarget = 0;
+
+    if (!cpu.ifId.valid) {
+        cpu.idEx.valid = false;
+        cpu.idEx.bubble = cpu.ifId.bubble;
+        return;
+    }
+
+    if (cpu.core.fusionIdioms) fuseWithNext(cpu);
+
+    if (cpu.replaySource && !replayHasRecords(cpu)) {
+        stall = true;
+        cpu.idEx.valid = false;
+        cpu.idEx.bubble = Bubble(BUBBLE_FETCH_STARVED, cpu.ifId.pc);
+        return;
+    }
+
+    bool isStalled = cpu.hazardUnit.detectHazardF(cpu.ifId, cpu.idEx, cpu.exMem, cpu.memWb, isForwarding,
+                                                  cpu.clockCycle, false);
+    stall = isStalled;
+
+    cpu.trackStage(cpu.ifId.pc, cpu.ifId.instruction, "ID");
+
+    if (isStalled) {
+        // The instruction behind is held in IF.  With a fetch queue it is
+        // already marked by the cycle it was fetched in.
+        uint32_t nextPC = cpu.pc;
+        if (cpu.core.fetchQueueDepth == 0) {
+            cpu.trackStage(nextPC, "IF");
+        }
+
+        cpu.stallCycles++;
+        if (cpu.hazardUnit.detectLoadHazard(cpu.ifId, cpu.idEx, cpu.clockCycle, isForwarding)) cpu.loadUseStalls++;
+        cpu.idEx.valid = false;
+        cpu.idEx.bubble = Bubble(BUBBLE_DATA_HAZARD, cpu.ifId.pc);
+        for (PipelineObserver* observer : cpu.observers) observer->onStall(cpu);
+        return;
+    }
+
+    bool isBranchOrJump = (cpu.ifId.instruction.format == B_TYPE ||
+                           cpu.ifId.instruction.format == J_TYPE ||
+                           (cpu.ifId.instruction.format == I_TYPE && cpu.ifId.instruction.opcode == JALR));
+
+    if (isBranchOrJump) {
+        // Initialize values
+        int32_t rs1Value = 0;
+        int32_t rs2Value = 0;
+
+        if (isForwarding) {
+            // First, check if branch depends on result still in ID/EX stage.
+            // A load with a predicted value already has its result.
+            bool needsStall = false;
+            if (cpu.ifId.instruction.rs1 != 0 &&
+                cpu.idEx.valid && cpu.idEx.control.regWrite && !cpu.idEx.valuePredicted &&
+                cpu.idEx.instruction.rd != 0 &&
+                cpu.idEx.instruction.rd == cpu.ifId.instruction.rs1) {
+                needsStall = true;
+            }
+
+            if (cpu.ifId.instruction.rs2 != 0 &&
+                cpu.idEx.valid && cpu.idEx.control.regWrite && !cpu.idEx.valuePredicted &&
+                cpu.idEx.instruction.rd != 0 &&
+                cpu.idEx.instruction.rd == cpu.ifId.instruction.rs2) {
+                needsStall = true;
+            }
+
+            if (needsStall) {
+                // Need to stall because branch depends on previous instruction still in ID/EX
+                stall = true;
+                cpu.stallCycles++;
+                cpu.idEx.valid = false;
+                cpu.idEx.bubble = Bubble(BUBBLE_DATA_HAZARD, cpu.ifId.pc);
+                for (PipelineObserver* observer : cpu.observers) observer->onStall(cpu);
+                return;
+            }
+
+            if (cpu.ifId.instruction.rs1 != 0) {
+                if (cpu.exMem.valid && cpu.exMem.control.regWrite &&
+                    cpu.exMem.instruction.rd != 0 &&
+                    cpu.exMem.instruction.rd == cpu.ifId.instruction.rs1) {
+                    rs1Value = exMemResult(cpu);
+                    notifyActivity(cpu, ACTIVITY_FORWARD, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+                }
+                else if (cpu.memWb.valid && cpu.memWb.control.regWrite &&
+                         cpu.memWb.instruction.rd != 0 &&
+                         cpu.memWb.instruction.rd == cpu.ifId.instruction.rs1) {
+                    rs1Value = cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+                    notifyActivity(cpu, ACTIVITY_FORWARD, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+                }
+                else {
+                    // No forwarding needed, read from register file
+                    rs1Value = cpu.regFile.read(cpu.ifId.instruction.rs1);
+                }
+            }
+
+            // Check for rs2 forwarding
+            if (cpu.ifId.instruction.rs2 != 0) {
+                if (cpu.exMem.valid && cpu.exMem.control.regWrite &&
+                    cpu.exMem.instruction.rd != 0 &&
+                    cpu.exMem.instruction.rd == cpu.ifId.instruction.rs2) {
+                    rs2Value = exMemResult(cpu);
+                    notifyActivity(cpu, ACTIVITY_FORWARD, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+                }
+                else if (cpu.memWb.valid && cpu.memWb.control.regWrite &&
+                         cpu.memWb.instruction.rd != 0 &&
+                         cpu.memWb.instruction.rd == cpu.ifId.instruction.rs2) {
+                    rs2Value = cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+                    notifyActivity(cpu, ACTIVITY_FORWARD, cpu.ifId.pc, cpu.ifId.instruction.opcode);
+                }
+                else {
+                    // No forwarding needed, read from register file
+                    rs2Value = cpu.regFile.read(cpu.ifId.instruction.rs2);
+                }
+            }
+        } else {
+            // Without forwarding, just read from register file
+            rs1Value = cpu.regFile.read(cpu.ifId.instruction.rs1);
+            rs2Value = cpu.regFile.read(cpu.ifId.instruction.rs2);
+        }
+
+        // A replayed branch goes where the recorded one did.
+        if (cpu.replaySource) {
+            const TraceRecord& record = *cpu.replaySource->record(cpu.replayCursor);
+            branchTaken = record.taken();
+            branchTarget = record.target;
+        }
+        // Rest of the branch logic using the potentially forwarded values
+        else {
+            branchTaken = resolveBranch(cpu.ifId.instruction, cpu.ifId.pc, rs1Value, rs2Value, branchTarget);
+        }
+    }
+
+    cpu.idEx.pc = cpu.ifId.pc;
+    cpu.idEx.instruction = cpu.ifId.instruction;
+    cpu.idEx.readData1 = readRegisterOperand(cpu, cpu.ifId.instruction.rs1, isForwarding);
+    cpu.idEx.readData2 = readRegisterOperand(cpu, cpu.ifId.instruction.rs2, isForwarding);
+    cpu.idEx.immediate = cpu.ifId.instruction.immediate;
+    if (cpu.replaySource) {
+        cpu.idEx.replayIndex = cpu.replayCursor;
+        cpu.replayCursor += cpu.ifId.instruction.fusion != FUSE_NONE ? 2 : 1;
+    }
+
+    cpu.setControlSignals(cpu.ifId.instruction, cpu.idEx.control);
+    cpu.hazardUnit.recordDecode(cpu.ifId.instruction, cpu.idEx.control, cpu.clockCycle, isForwarding);
+    predictLoad(cpu, isForwarding);
+
+    if (branchTaken) {
+        cpu.idEx.control.branch = false;
+        cpu.idEx.control.jump = false;
+    }
+
+    if (!cpu.observers.empty()) {
+        const Instruction& decoded = cpu.idEx.instruction;
+        if (readsRs1(decoded)) notifyActivity(cpu, ACTIVITY_REGISTER_READ, cpu.idEx.pc, decoded.opcode);
+        if (readsRs2(decoded)) notifyActivity(cpu, ACTIVITY_REGISTER_READ, cpu.idEx.pc, decoded.opcode);
+        notifyActivity(cpu, ACTIVITY_LATCH_WRITE, cpu.idEx.pc, decoded.opcode);
+    }
+
+    cpu.idEx.valid = true;
+}
+
+template <bool isForwarding>
+void executeStage(Processor& cpu) {
+    if (!cpu.idEx.valid) {
+        cpu.exMem.valid = false;
+        cpu.exMem.bubble = cpu.idEx.bubble;
+        return;
+    }
+
+    cpu.trackStage(cpu.idEx.pc, cpu.idEx.instruction, "EX");
+
+    // Taken before the latch starts filling with this instruction's fields.
+    int32_t exMemForward = exMemResult(cpu);
+
+    cpu.exMem.pc = cpu.idEx.pc;
+    cpu.exMem.control = cpu.idEx.control;
+    cpu.exMem.readData2 = cpu.idEx.readData2;
+
+    int32_t aluInput1, aluInput2, rs2Value;
+
+    if (isForwarding) {
+        cpu.forwardUnit.detectForwarding(cpu.idEx, cpu.exMem, cpu.memWb);
+
+        switch (cpu.forwardUnit.forwardA) {
+            case ForwardingUnit::FROM_EX_MEM:
+                aluInput1 = exMemForward;
+                break;
+            case ForwardingUnit::FROM_MEM_WB:
+                aluInput1 = cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+                break;
+            default:
+                aluInput1 = cpu.idEx.readData1;
+                break;
+        }
+
+        switch (cpu.forwardUnit.forwardB) {
+            case ForwardingUnit::FROM_EX_MEM:
+                rs2Value = exMemForward;
+                break;
+            case ForwardingUnit::FROM_MEM_WB:
+                rs2Value = cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+                break;
+            default:
+                rs2Value = cpu.idEx.readData2;
+                break;
+        }
+
+        aluInput2 = cpu.idEx.control.aluSrc ? cpu.idEx.immediate : rs2Value;
+        if (cpu.idEx.control.memWrite) cpu.exMem.readData2 = rs2Value;
+
+        const Instruction& executing = cpu.idEx.instruction;
+        if (cpu.forwardUnit.forwardA != ForwardingUnit::FROM_REG && readsRs1(executing)) {
+            notifyActivity(cpu, ACTIVITY_FORWARD, cpu.idEx.pc, executing.opcode);
+        }
+        if (cpu.forwardUnit.forwardB != ForwardingUnit::FROM_REG && readsRs2(executing)) {
+            notifyActivity(cpu, ACTIVITY_FORWARD, cpu.idEx.pc, executing.opcode);
+        }
+    } else {
+        aluInput1 = cpu.idEx.readData1;
+        rs2Value = cpu.idEx.readData2;
+        aluInput2 = cpu.idEx.control.aluSrc ? cpu.idEx.immediate : cpu.idEx.readData2;
+    }
+
+    cpu.exMem.instruction = cpu.idEx.instruction;
+
+    if (cpu.replaySource) {
+        // Nothing is computed in replay; memory ops take their address and
+        // the value loaded or stored from the trace.
+        const TraceRecord& record = replayRecord(cpu, cpu.idEx);
+        cpu.exMem.aluResult.result = record.address;
+        cpu.exMem.loadData = record.value;
+        if (cpu.idEx.control.memWrite) cpu.exMem.readData2 = record.value;
+    } else {
+        cpu.exMem.aluResult.result = aluResult(cpu.idEx.instruction, cpu.idEx.pc, aluInput1, aluInput2, rs2Value);
+    }
+    cpu.exMem.replayIndex = cpu.idEx.replayIndex;
+
+    cpu.exMem.aluResult.zero = (cpu.exMem.aluResult.result == 0);
+    cpu.exMem.aluResult.negative = (cpu.exMem.aluResult.result < 0);
+
+    // With early address generation the load reads memory here.  An older
+    // store in MEM has already written this cycle, since MEM runs first.
+    if (cpu.core.earlyLoadAddress && cpu.exMem.control.memRead) {
+        if (!cpu.replaySource) {
+            cpu.exMem.loadData = readDataMemory(cpu.dataMem, cpu.exMem.instruction.opcode, cpu.exMem.aluResult.result);
+        }
+        notifyActivity(cpu, ACTIVITY_DATA_READ, cpu.exMem.pc, cpu.exMem.instruction.opcode);
+    }
+
+    // Consumers see a predicted value until MEM has checked it.
+    cpu.exMem.valuePredicted = cpu.idEx.valuePredicted;
+    cpu.exMem.predictedValue = cpu.idEx.predictedValue;
+
+    notifyActivity(cpu, ACTIVITY_ALU, cpu.exMem.pc, cpu.exMem.instruction.opcode);
+    notifyActivity(cpu, ACTIVITY_LATCH_WRITE, cpu.exMem.pc, cpu.exMem.instruction.opcode);
+    cpu.exMem.valid = true;
+}
+
+static uint8_t memoryAccessSize(Opcode opcode) {
+    switch (opcode) {
+        case LB: case LBU: case SB: return 1;
+        case LH: case LHU: case SH: return 2;
+        default: return 4;
+    }
+}
+
+static void notifyMemoryAccess(Processor& cpu, uint32_t address, int32_t value, bool isWrite) {
+    MemoryAccess access;
+    access.cycle = cpu.clockCycle;
+    access.pc = cpu.exMem.pc;
+    access.address = address;
+    access.size = memoryAccessSize(cpu.exMem.instruction.opcode);
+    access.value = access.size == 4 ? value : value & ((1 << (8 * access.size)) - 1);
+    access.isWrite = isWrite;
+
+    for (PipelineObserver* observer : cpu.observers) observer->onMemoryAccess(cpu, access);
+}
+
+void memoryStage(Processor& cpu) {
+    if (!cpu.exMem.valid) {
+        cpu.memWb.valid = false;
+        cpu.memWb.bubble = cpu.exMem.bubble;
+        return;
+    }
+
+    cpu.trackStage(cpu.exMem.pc, cpu.exMem.instruction, "MEM");
+
+    cpu.memWb.instruction = cpu.exMem.instruction;
+    cpu.memWb.pc = cpu.exMem.pc;
+    cpu.memWb.control = cpu.exMem.control;
+    cpu.memWb.aluResult = cpu.exMem.aluResult.result;
+
+    if (cpu.exMem.control.memRead) {
+        uint32_t address = cpu.exMem.aluResult.result;
+
+        if (cpu.core.earlyLoadAddress) {
+            cpu.memWb.readData = cpu.exMem.loadData;
+        } else {
+            cpu.memWb.readData = cpu.replaySource ? cpu.exMem.loadData
+                                                 : readDataMemory(cpu.dataMem, cpu.exMem.instruction.opcode, address);
+            notifyActivity(cpu, ACTIVITY_DATA_READ, cpu.exMem.pc, cpu.exMem.instruction.opcode);
+        }
+
+        cpu.loadsExecuted++;
+        if (cpu.loadPredictor.enabled()) checkLoadPrediction(cpu, address);
+
+        if (!cpu.observers.empty()) notifyMemoryAccess(cpu, address, cpu.memWb.readData, false);
+    } else {
+        cpu.memWb.readData = 0;
+    }
+
+    if (cpu.exMem.control.memWrite) {
+        uint32_t address = cpu.exMem.aluResult.result;
+        int32_t value = cpu.exMem.readData2;
+
+        if (!cpu.replaySource) writeDataMemory(cpu.dataMem, cpu.exMem.instruction.opcode, address, value);
+
+        if (!cpu.observers.empty()) notifyMemoryAccess(cpu, address, value, true);
+        notifyActivity(cpu, ACTIVITY_DATA_WRITE, cpu.exMem.pc, cpu.exMem.instruction.opcode);
+    }
+
+    // A squash after this point restarts behind this instruction at the
+    // earliest, so its records are done with.
+    if (cpu.replaySource) {
+        cpu.replaySource->release(cpu.exMem.replayIndex + (cpu.exMem.instruction.fusion != FUSE_NONE ? 2 : 1));
+    }
+
+    notifyActivity(cpu, ACTIVITY_LATCH_WRITE, cpu.memWb.pc, cpu.memWb.instruction.opcode);
+    cpu.memWb.valid = true;
+}
+
+void writeBackStage(Processor& cpu) {
+    if (!cpu.memWb.valid) {
+        for (PipelineObserver* observer : cpu.observers) observer->onBubble(cpu, cpu.memWb.bubble);
+        return;
+    }
+
+    cpu.trackStage(cpu.memWb.pc, cpu.memWb.instruction, "WB");
+
+    if (cpu.memWb.control.regWrite && cpu.memWb.instruction.rd != 0) {
+        int32_t writeData = cpu.memWb.control.memToReg ? cpu.memWb.readData : cpu.memWb.aluResult;
+        if (!cpu.replaySource) cpu.regFile.write(cpu.memWb.instruction.rd, writeData);
+        notifyActivity(cpu, ACTIVITY_REGISTER_WRITE, cpu.memWb.pc, cpu.memWb.instruction.opcode);
+    }
+
+    cpu.instructionsExecuted += cpu.memWb.instruction.fusion != FUSE_NONE ? 2 : 1;
+
+    for (PipelineObserver* observer : cpu.observers) observer->onRetire(cpu, cpu.memWb);
+}
+
+void initPipelineTrace(Processor& cpu) {
+    cpu.clearInstructionTraces();
+}
+
+template <bool isForwarding>
+void stepCycle(Processor& cpu) {
+    cpu.clockCycle++;
+
+    writeBackStage(cpu);
+    memoryStage(cpu);
+    executeStage<isForwarding>(cpu);
+
+    bool stall = false;
+    bool branchTaken = false;
+    uint32_t branchTarget = 0;
+
+    instructionDecodeStage<isForwarding>(cpu, stall, branchTaken, branchTarget);
+    instructionFetchStage<isForwarding>(cpu, stall);
+
+    if (branchTaken) {
+        if (cpu.loopBuffer.replaying() && cpu.ifId.valid && cpu.ifId.pc == branchTarget) {
+            // The loop buffer already put the loop head behind its closing
+            // branch.
+            cpu.loopFlushesAvoided++;
+        } else {
+            redirectFetch(cpu, branchTarget, cpu.idEx.pc, BUBBLE_BRANCH_FLUSH);
+            cpu.branchFlushes++;
+            if (cpu.loopBuffer.enabled() && branchTarget < cpu.idEx.pc && cpu.idEx.instruction.opcode != JALR) {
+                cpu.loopBuffer.takenBackward(cpu.idEx.pc, branchTarget);
+            }
+        }
+    } else if (cpu.loopBuffer.replaying() && cpu.idEx.valid && cpu.idEx.pc == cpu.loopBuffer.branchPc) {
+        // The loop exits: fetch falls through past the closing branch.
+        redirectFetch(cpu, cpu.idEx.pc + cpu.idEx.instruction.length, cpu.idEx.pc, BUBBLE_BRANCH_FLUSH);
+        cpu.branchFlushes++;
+    }
+
+    if (cpu.exMem.valid && ((cpu.exMem.control.branch && cpu.exMem.branchTaken) ||
+                          cpu.exMem.control.jump)) {
+        redirectFetch(cpu, cpu.exMem.branchTarget, cpu.exMem.pc, BUBBLE_BRANCH_FLUSH);
+    }
+}
+
+template void instructionFetchStage<false>(Processor& cpu, bool& stall);
+template void instructionFetchStage<true>(Processor& cpu, bool& stall);
+template void instructionDecodeStage<false>(Processor& cpu, bool& stall, bool& branchTaken, uint32_t& branchTarget);
+template void instructionDecodeStage<true>(Processor& cpu, bool& stall, bool& branchTaken, uint32_t& branchTarget);
+template void executeStage<false>(Processor& cpu);
+template void executeStage<true>(Processor& cpu);
+template void stepCycle<false>(Processor& cpu);
+template void stepCycle<true>(Processor& cpu);
+
+CycleFunction cycleFunction(bool isForwarding) {
+    return isForwarding ? &stepCycle<true> : &stepCycle<false>;
+}
+
+void stepCycle(Processor& cpu, bool isForwarding) {
+    cycleFunction(isForwarding)(cpu);
+}
+
+void executePipeline(Processor& cpu, int cycles, bool isForwarding) {
+    cpu.reset();
+    initPipelineTrace(cpu);
+
+    std::cout << "Running pipeline with " << (isForwarding ? "forwarding enabled" : "forwarding disabled") << std::endl;
+
+    CycleFunction cycle = cycleFunction(isForwarding);
+    for (int i = 0; i < cycles; i++) cycle(cpu);
+
+    cpu.printTerminalTrace(std::cout);
+}
@@ -0,0 +1,38 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "processor.hpp"
+
+// The forwarding-dependent stages are instantiated once per mode, so the
+// choice is made when a cycle function is picked rather than in every stage.
+template <bool isForwarding> void instructionFetchStage(Processor& cpu, bool& stall);
+template <bool isForwarding>
+void instructionDecodeStage(Processor& cpu, bool& stall, bool& branchTaken, uint32_t& branchTarget);
+template <bool isForwarding> void executeStage(Processor& cpu);
+void memoryStage(Processor& cpu);
+void writeBackStage(Processor& cpu);
+
+// The datapath pieces the stages share with architectural-only execution
+// (functional.hpp): the result EX computes for `inst` at `pc`, how ID
+// resolves a branch or jump, and data memory access by load/store opcode.
+int32_t aluResult(const Instruction& inst, uint32_t pc, int32_t aluInput1, int32_t aluInput2, int32_t rs2Value);
+bool resolveBranch(const Instruction& inst, uint32_t pc, int32_t rs1Value, int32_t rs2Value, uint32_t& target);
+int32_t readDataMemory(const DataMemory& memory, Opcode opcode, uint32_t address);
+void writeDataMemory(DataMemory& memory, Opcode opcode, uint32_t address, int32_t value);
+
+// Empties the stage table.  Rows are added as instructions first reach a
+// stage and are listed in address order.
+void initPipelineTrace(Processor& cpu);
+
+// Advances the pipeline by exactly one clock cycle.
+template <bool isForwarding> void stepCycle(Processor& cpu);
+void stepCycle(Processor& cpu, bool isForwarding = false);
+
+// The cycle function specialized for a forwarding mode, for callers that
+// step many cycles under one configuration.
+typedef void (*CycleFunction)(Processor& cpu);
+CycleFunction cycleFunction(bool isForwarding);
+
+void executePipeline(Processor& cpu, int cycles, bool isForwarding = false);
+
+#endif
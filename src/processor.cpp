@@ -0,0 +1,607 @@
+#include "processor.hpp"
+
+#include <iomanip>
+
+const std::map<Opcode, std::string> opcodeToString = {
+    {ADD, "add"}, {SUB, "sub"}, {SLL, "sll"}, {SLT, "slt"}, {SLTU, "sltu"},
+    {XOR, "xor"}, {SRL, "srl"}, {SRA, "sra"}, {OR, "or"}, {AND, "and"},
+    {ADDI, "addi"}, {SLTI, "slti"}, {SLTIU, "sltiu"}, {XORI, "xori"},
+    {ORI, "ori"}, {ANDI, "andi"}, {SLLI, "slli"}, {SRLI, "srli"}, {SRAI, "srai"},
+    {LB, "lb"}, {LH, "lh"}, {LW, "lw"}, {LBU, "lbu"}, {LHU, "lhu"},
+    {SB, "sb"}, {SH, "sh"}, {SW, "sw"},
+    {BEQ, "beq"}, {BNE, "bne"}, {BLT, "blt"}, {BGE, "bge"}, {BLTU, "bgeu"}, {BGEU, "bgeu"},
+    {LUI, "lui"}, {AUIPC, "auipc"},
+    {JAL, "jal"}, {JALR, "jalr"}
+};
+
+const char* const fusionKindNames[FUSION_KIND_COUNT] = {
+    "none", "indexed-load", "load-imm", "pc-relative", "shift-add", "zero-extend"
+};
+
+void Processor::savePipelineState(PipelineState& state) const {
+    state = *this;
+}
+
+void Processor::restorePipelineState(const PipelineState& state) {
+    static_cast<PipelineState&>(*this) = state;
+
+    // Stage columns recorded after the restored cycle belong to a future that
+    // has not happened yet on this timeline, and so do the rows of
+    // instructions that first reached a stage there.
+    size_t kept = 0;
+    for (size_t row = 0; row < instructionTraces.size(); row++) {
+        InstructionTrace& trace = instructionTraces[row];
+        if (trace.stages.size() > static_cast<size_t>(clockCycle)) trace.stages.resize(clockCycle);
+        bool reached = std::any_of(trace.stages.begin(), trace.stages.end(),
+                                   [](const std::string& stage) { return stage != "-"; });
+        traceRows[trace.address / 2] = reached ? kept : -1;
+        if (!reached) continue;
+        if (kept != row) instructionTraces[kept] = std::move(trace);
+        kept++;
+    }
+    instructionTraces.resize(kept);
+}
+
+void Processor::saveSnapshot(ProcessorSnapshot& snapshot) const {
+    savePipelineState(snapshot.pipeline);
+    snapshot.regFile = regFile;
+    snapshot.dataMem = dataMem;
+}
+
+void Processor::restoreSnapshot(const ProcessorSnapshot& snapshot) {
+    restorePipelineState(snapshot.pipeline);
+    regFile = snapshot.regFile;
+    dataMem = snapshot.dataMem;
+}
+
+int Processor::initInstructionTrace(uint32_t pc) {
+    int existing = findInstructionTrace(pc);
+    if (existing >= 0 || !instMem.contains(pc)) return existing;
+
+    uint32_t raw = instMem.readInstruction(pc);
+    InstructionTrace trace;
+    trace.address = pc;
+    trace.raw = raw;
+
+    Instruction inst;
+    decodeInstruction(raw, inst);
+    if (inst.opcode != INVALID) {
+        std::string opName = opcodeToString.at(inst.opcode);
+        std::string regNames = "";
+
+        if (inst.format == R_TYPE) {
+            regNames = " x" + std::to_string(inst.rd) + ",x" + std::to_string(inst.rs1) + ",x" + std::to_string(inst.rs2);
+        } else if (inst.format == I_TYPE) {
+            regNames = " x" + std::to_string(inst.rd) + ",x" + std::to_string(inst.rs1) + "," + std::to_string(inst.immediate);
+        } else if (inst.format == J_TYPE) {
+            regNames = " x" + std::to_string(inst.rd) + "," + std::to_string(inst.immediate);
+        } else if (inst.format == B_TYPE) {
+            regNames = " x" + std::to_string(inst.rs1) + ",x" + std::to_string(inst.rs2) + "," + std::to_string(inst.immediate);
+        }
+
+        trace.disassembly = (inst.length == 2 ? "c." : "") + opName + regNames;
+    } else {
+        trace.disassembly = "unknown";
+    }
+
+    if (traceRows.size() < instMem.size() / 2) traceRows.resize(instMem.size() / 2, -1);
+    traceRows[pc / 2] = instructionTraces.size();
+    instructionTraces.push_back(trace);
+    return traceRows[pc / 2];
+}
+
+std::vector<const Processor::InstructionTrace*> Processor::instructionTracesByAddress() const {
+    std::vector<const InstructionTrace*> rows;
+    rows.reserve(instructionTraces.size());
+    for (int row : traceRows) {
+        if (row >= 0) rows.push_back(&instructionTraces[row]);
+    }
+    return rows;
+}
+
+void Processor::trackInstructionStage(int instructionIndex, int cycle, const std::string& stage) {
+    if (instructionIndex >= 0 && static_cast<size_t>(instructionIndex) < instructionTraces.size()) {
+        if (instructionTraces[instructionIndex].stages.size() <= static_cast<size_t>(cycle)) {
+            instructionTraces[instructionIndex].stages.resize(cycle + 1, "-");
+        }
+        instructionTraces[instructionIndex].stages[cycle] = stage;
+    }
+}
+
+void Processor::outputPipelineTraceCSV(std::ostream& traceFile) const {
+    traceFile << "PC,Instruction,";
+    for (int i = 1; i <= clockCycle; i++) {
+        traceFile << "Cycle " << i;
+        if (i < clockCycle) traceFile << ",";
+    }
+    traceFile << std::endl;
+
+    for (const InstructionTrace* row : instructionTracesByAddress()) {
+        const InstructionTrace& trace = *row;
+        traceFile << std::hex << "0x" << trace.address << ","
+                  << trace.disassembly << ",";
+
+        for (int i = 0; i < clockCycle; i++) {
+            if (static_cast<size_t>(i) < trace.stages.size()) {
+                traceFile << trace.stages[i];
+            } else {
+                traceFile << "-";
+            }
+            if (i < clockCycle - 1) traceFile << ",";
+        }
+        traceFile << std::endl;
+    }
+}
+
+void Processor::outputPipelineTraceTXT(std::ostream& outputFile) const {
+    for (const InstructionTrace* row : instructionTracesByAddress()) {
+        const InstructionTrace& trace = *row;
+        outputFile << trace.disassembly << ";";
+
+        for (int i = 0; i < clockCycle; i++) {
+            if (static_cast<size_t>(i) < trace.stages.size()) {
+                outputFile << trace.stages[i];
+            } else {
+                outputFile << "-";
+            }
+            if (i < clockCycle - 1) outputFile << ";";
+        }
+        outputFile << std::endl;
+    }
+}
+
+void Processor::printTraceHeader(std::ostream& traceFile) const {
+    traceFile << "Cycle\tPC\tInstruction\tIF/ID.IR\tID/EX.IR\tEX/MEM.IR\tMEM/WB.IR\n";
+}
+
+void Processor::printTrace(std::ostream& traceFile) const {
+    traceFile << clockCycle << "\t";
+    traceFile << std::hex << pc << "\t";
+
+    uint32_t currentInst = instMem.readInstruction(pc);
+    traceFile << std::hex << currentInst << "\t";
+
+    traceFile << std::hex << (ifId.valid ? ifId.instruction.raw : 0) << "\t";
+    traceFile << std::hex << (idEx.valid ? idEx.instruction.raw : 0) << "\t";
+    traceFile << std::hex << (exMem.valid ? exMem.instruction.raw : 0) << "\t";
+    traceFile << std::hex << (memWb.valid ? memWb.instruction.raw : 0) << "\n";
+}
+
+static uint32_t encodeR(uint32_t funct7, int rs2, int rs1, uint32_t funct3, int rd, uint32_t opcode) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encodeI(uint32_t imm, int rs1, uint32_t funct3, int rd, uint32_t opcode) {
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static uint32_t encodeS(uint32_t imm, int rs2, int rs1, uint32_t funct3) {
+    return (((imm >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | 0x23;
+}
+
+static uint32_t encodeB(uint32_t imm, int rs2, int rs1, uint32_t funct3) {
+    return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) |
+           (funct3 << 12) | (((imm >> 1) & 0xF) << 8) | (((imm >> 11) & 1) << 7) | 0x63;
+}
+
+static uint32_t encodeJ(uint32_t imm, int rd) {
+    return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3FF) << 21) | (((imm >> 11) & 1) << 20) |
+           (((imm >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F;
+}
+
+static uint32_t bits(uint32_t value, int high, int low) {
+    return (value >> low) & ((1u << (high - low + 1)) - 1);
+}
+
+static int32_t signExtend(uint32_t value, int width) {
+    return static_cast<int32_t>(value << (32 - width)) >> (32 - width);
+}
+
+// Expands a 16-bit RV32C instruction into the 32-bit RV32I instruction it
+// stands for.  Encodings outside RV32IC (floating point, c.ebreak, reserved
+// ones) expand to an all-ones word, which decodes as INVALID.
+static uint32_t expandCompressed(uint32_t c) {
+    const uint32_t illegal = 0xFFFFFFFF;
+    uint32_t funct3 = bits(c, 15, 13);
+    int rdFull = bits(c, 11, 7);
+    int rs2Full = bits(c, 6, 2);
+    int rdPrime = bits(c, 4, 2) + 8;    // rd' / rs2' in quadrants 0 and 1
+    int rs1Prime = bits(c, 9, 7) + 8;
+    int32_t imm6 = signExtend((bits(c, 12, 12) << 5) | bits(c, 6, 2), 6);
+    int32_t jumpOffset = signExtend((bits(c, 12, 12) << 11) | (bits(c, 8, 8) << 10) | (bits(c, 10, 9) << 8) |
+                                    (bits(c, 6, 6) << 7) | (bits(c, 7, 7) << 6) | (bits(c, 2, 2) << 5) |
+                                    (bits(c, 11, 11) << 4) | (bits(c, 5, 3) << 1), 12);
+
+    switch (c & 3) {
+        case 0: {
+            uint32_t wordOffset = (bits(c, 5, 5) << 6) | (bits(c, 12, 10) << 3) | (bits(c, 6, 6) << 2);
+            switch (funct3) {
+                case 0: { // c.addi4spn
+                    uint32_t imm = (bits(c, 10, 7) << 6) | (bits(c, 12, 11) << 4) | (bits(c, 5, 5) << 3) |
+                                   (bits(c, 6, 6) << 2);
+                    return imm ? encodeI(imm, 2, 0, rdPrime, 0x13) : illegal;
+                }
+                case 2: return encodeI(wordOffset, rs1Prime, 2, rdPrime, 0x03);   // c.lw
+                case 6: return encodeS(wordOffset, rdPrime, rs1Prime, 2);         // c.sw
+                default: return illegal;
+            }
+        }
+
+        case 1:
+            switch (funct3) {
+                case 0: return encodeI(imm6, rdFull, 0, rdFull, 0x13);      // c.addi, c.nop
+                case 1: return encodeJ(jumpOffset, 1);                      // c.jal
+                case 2: return encodeI(imm6, 0, 0, rdFull, 0x13);           // c.li
+                case 3:
+                    if (rdFull == 2) { // c.addi16sp
+                        int32_t imm = signExtend((bits(c, 12, 12) << 9) | (bits(c, 4, 3) << 7) | (bits(c, 5, 5) << 6) |
+                                                 (bits(c, 2, 2) << 5) | (bits(c, 6, 6) << 4), 10);
+                        return imm ? encodeI(imm, 2, 0, 2, 0x13) : illegal;
+                    }
+                    return imm6 ? ((static_cast<uint32_t>(imm6) << 12) | (rdFull << 7) | 0x37) : illegal;   // c.lui
+                case 4:
+                    switch (bits(c, 11, 10)) {
+                        case 0: return bits(c, 12, 12) ? illegal : encodeI(rs2Full, rs1Prime, 5, rs1Prime, 0x13);   // c.srli
+                        case 1: return bits(c, 12, 12) ? illegal : encodeI(0x400 | rs2Full, rs1Prime, 5, rs1Prime, 0x13);   // c.srai
+                        case 2: return encodeI(imm6, rs1Prime, 7, rs1Prime, 0x13);   // c.andi
+                        default: {
+                            if (bits(c, 12, 12)) return illegal;
+                            const uint32_t funct7[4] = {0x20, 0, 0, 0};
+                            const uint32_t aluFunct3[4] = {0, 4, 6, 7};   // c.sub, c.xor, c.or, c.and
+                            uint32_t op = bits(c, 6, 5);
+                            return encodeR(funct7[op], rdPrime, rs1Prime, aluFunct3[op], rs1Prime, 0x33);
+                        }
+                    }
+                case 5: return encodeJ(jumpOffset, 0);                      // c.j
+                case 6:
+                case 7: {                                                   // c.beqz, c.bnez
+                    int32_t offset = signExtend((bits(c, 12, 12) << 8) | (bits(c, 6, 5) << 6) | (bits(c, 2, 2) << 5) |
+                                                (bits(c, 11, 10) << 3) | (bits(c, 4, 3) << 1), 9);
+                    return encodeB(offset, 0, rs1Prime, funct3 == 6 ? 0 : 1);
+                }
+            }
+            return illegal;
+
+        case 2:
+            switch (funct3) {
+                case 0: return bits(c, 12, 12) ? illegal : encodeI(rs2Full, rdFull, 1, rdFull, 0x13);   // c.slli
+                case 2: { // c.lwsp
+                    uint32_t offset = (bits(c, 3, 2) << 6) | (bits(c, 12, 12) << 5) | (bits(c, 6, 4) << 2);
+                    return rdFull ? encodeI(offset, 2, 2, rdFull, 0x03) : illegal;
+                }
+                case 4:
+                    if (!bits(c, 12, 12)) {
+                        if (rs2Full == 0) return rdFull ? encodeI(0, rdFull, 0, 0, 0x67) : illegal;   // c.jr
+                        return encodeR(0, rs2Full, 0, 0, rdFull, 0x33);                               // c.mv
+                    }
+                    if (rs2Full == 0) return rdFull ? encodeI(0, rdFull, 0, 1, 0x67) : illegal;       // c.jalr
+                    return encodeR(0, rs2Full, rdFull, 0, rdFull, 0x33);                              // c.add
+                case 6: { // c.swsp
+                    uint32_t offset = (bits(c, 8, 7) << 6) | (bits(c, 12, 9) << 2);
+                    return encodeS(offset, rs2Full, 2, 2);
+                }
+                default: return illegal;
+            }
+    }
+    return illegal;
+}
+
+void Processor::decodeInstruction(uint32_t rawInst, Instruction& inst) const {
+    if (InstructionMemory::isCompressed(rawInst)) {
+        decodeInstruction(expandCompressed(rawInst & 0xFFFF), inst);
+        inst.raw = rawInst & 0xFFFF;
+        inst.length = 2;
+        return;
+    }
+
+    inst.raw = rawInst;
+    inst.length = 4;
+    inst.fusion = FUSE_NONE;
+    uint32_t opcodeField = rawInst & 0x7F;
+
+    switch (opcodeField) {
+        case 0x33: { // R-type
+            inst.format = R_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.rs2 = (rawInst >> 20) & 0x1F;
+
+            uint32_t funct3 = (rawInst >> 12) & 0x7;
+            uint32_t funct7 = (rawInst >> 25) & 0x7F;
+
+            if (funct7 == 0x00) {
+                switch (funct3) {
+                    case 0x0: inst.opcode = ADD; break;
+                    case 0x1: inst.opcode = SLL; break;
+                    case 0x2: inst.opcode = SLT; break;
+                    case 0x3: inst.opcode = SLTU; break;
+                    case 0x4: inst.opcode = XOR; break;
+                    case 0x5: inst.opcode = SRL; break;
+                    case 0x6: inst.opcode = OR; break;
+                    case 0x7: inst.opcode = AND; break;
+                    default: inst.opcode = INVALID;
+                }
+            } else if (funct7 == 0x20) {
+                switch (funct3) {
+                    case 0x0: inst.opcode = SUB; break;
+                    case 0x5: inst.opcode = SRA; break;
+                    default: inst.opcode = INVALID;
+                }
+            } else {
+                inst.opcode = INVALID;
+            }
+            break;
+        }
+
+        case 0x13: { // I-type (immediate)
+            inst.format = I_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.immediate = (rawInst >> 20);
+            if (inst.immediate & 0x800) inst.immediate |= 0xFFFFF000;
+
+            uint32_t funct3_i = (rawInst >> 12) & 0x7;
+
+            switch (funct3_i) {
+                case 0x0: inst.opcode = ADDI; break;
+                case 0x2: inst.opcode = SLTI; break;
+                case 0x3: inst.opcode = SLTIU; break;
+                case 0x4: inst.opcode = XORI; break;
+                case 0x6: inst.opcode = ORI; break;
+                case 0x7: inst.opcode = ANDI; break;
+                case 0x1: inst.opcode = SLLI; break;
+                case 0x5:
+                    if (((rawInst >> 25) & 0x7F) == 0x00) {
+                        inst.opcode = SRLI;
+                    } else if (((rawInst >> 25) & 0x7F) == 0x20) {
+                        inst.opcode = SRAI;
+                    } else {
+                        inst.opcode = INVALID;
+                    }
+                    break;
+                default: inst.opcode = INVALID;
+            }
+            break;
+        }
+
+        case 0x03: { // I-type (loads)
+            inst.format = I_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.immediate = (rawInst >> 20);
+            if (inst.immediate & 0x800) inst.immediate |= 0xFFFFF000;
+
+            uint32_t funct3_l = (rawInst >> 12) & 0x7;
+
+            switch (funct3_l) {
+                case 0x0: inst.opcode = LB; break;
+                case 0x1: inst.opcode = LH; break;
+                case 0x2: inst.opcode = LW; break;
+                case 0x4: inst.opcode = LBU; break;
+                case 0x5: inst.opcode = LHU; break;
+                default: inst.opcode = INVALID;
+            }
+            break;
+        }
+
+        case 0x23: { // S-type
+            inst.format = S_TYPE;
+            inst.rd = 0;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.rs2 = (rawInst >> 20) & 0x1F;
+            inst.immediate = ((rawInst >> 25) & 0x7F) << 5;
+            inst.immediate |= (rawInst >> 7) & 0x1F;
+            if (inst.immediate & 0x800) inst.immediate |= 0xFFFFF000;
+
+            uint32_t funct3_s = (rawInst >> 12) & 0x7;
+
+            switch (funct3_s) {
+                case 0x0: inst.opcode = SB; break;
+                case 0x1: inst.opcode = SH; break;
+                case 0x2: inst.opcode = SW; break;
+                default: inst.opcode = INVALID;
+            }
+            break;
+        }
+
+        case 0x63: { // B-type
+            inst.format = B_TYPE;
+            inst.rd = 0;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.rs2 = (rawInst >> 20) & 0x1F;
+            inst.immediate = 0;
+            inst.immediate |= ((rawInst >> 31) & 0x1) << 12;
+            inst.immediate |= ((rawInst >> 7) & 0x1) << 11;
+            inst.immediate |= ((rawInst >> 25) & 0x3F) << 5;
+            inst.immediate |= ((rawInst >> 8) & 0xF) << 1;
+            if (inst.immediate & 0x1000) inst.immediate |= 0xFFFFE000;
+
+            uint32_t funct3_b = (rawInst >> 12) & 0x7;
+
+            switch (funct3_b) {
+                case 0x0: inst.opcode = BEQ; break;
+                case 0x1: inst.opcode = BNE; break;
+                case 0x4: inst.opcode = BLT; break;
+                case 0x5: inst.opcode = BGE; break;
+                case 0x6: inst.opcode = BLTU; break;
+                case 0x7: inst.opcode = BGEU; break;
+                default: inst.opcode = INVALID;
+            }
+            break;
+        }
+
+        case 0x37: // U-type (LUI)
+            inst.format = U_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.immediate = rawInst & 0xFFFFF000;
+            inst.opcode = LUI;
+            break;
+
+        case 0x17: // U-type (AUIPC)
+            inst.format = U_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.immediate = rawInst & 0xFFFFF000;
+            inst.opcode = AUIPC;
+            break;
+
+        case 0x6F: { // J-type (JAL)
+            inst.format = J_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.immediate = 0;
+            inst.immediate |= ((rawInst >> 31) & 0x1) << 20;
+            inst.immediate |= ((rawInst >> 12) & 0xFF) << 12;
+            inst.immediate |= ((rawInst >> 20) & 0x1) << 11;
+            inst.immediate |= ((rawInst >> 21) & 0x3FF) << 1;
+            if (inst.immediate & 0x100000) inst.immediate |= 0xFFF00000;
+            inst.opcode = JAL;
+            break;
+        }
+
+        case 0x67: { // I-type (JALR)
+            inst.format = I_TYPE;
+            inst.rd = (rawInst >> 7) & 0x1F;
+            inst.rs1 = (rawInst >> 15) & 0x1F;
+            inst.immediate = (rawInst >> 20);
+            if (inst.immediate & 0x800) inst.immediate |= 0xFFFFF000;
+            inst.opcode = JALR;
+            break;
+        }
+
+        default:
+            inst.opcode = INVALID;
+            break;
+    }
+}
+
+void Processor::setControlSignals(const Instruction& inst, ControlSignals& control) const {
+    control = ControlSignals();
+
+    switch (inst.format) {
+        case R_TYPE:
+            control.regWrite = true;
+            control.aluOp = 2;
+            break;
+
+        case I_TYPE:
+            if (inst.opcode == JALR) {
+                control.regWrite = true;
+                control.jump = true;
+                control.aluOp = 0;
+            } else if (inst.opcode >= LB && inst.opcode <= LHU) {
+                control.regWrite = true;
+                control.memRead = true;
+                control.memToReg = true;
+                control.aluSrc = true;
+                control.aluOp = 0;
+            } else {
+                control.regWrite = true;
+                control.aluSrc = true;
+                control.aluOp = 3;
+            }
+            break;
+
+        case S_TYPE:
+            control.memWrite = true;
+            control.aluSrc = true;
+            control.aluOp = 0;
+            break;
+
+        case B_TYPE:
+            control.branch = true;
+            control.aluOp = 1;
+            break;
+
+        case U_TYPE:
+            control.regWrite = true;
+            if (inst.opcode == AUIPC) {
+                control.aluOp = 0;
+                control.aluSrc = true;
+            } else {
+                control.aluOp = 4;
+                control.aluSrc = true;
+            }
+            break;
+
+        case J_TYPE:
+            control.regWrite = true;
+            control.jump = true;
+            break;
+    }
+
+    // An indexed load reads two registers like an R-type op and then
+    // accesses memory like a load.
+    if (inst.fusion == FUSE_INDEXED_LOAD) {
+        control.memRead = true;
+        control.memToReg = true;
+        control.aluSrc = true;
+        control.aluOp = 0;
+    }
+}
+
+bool Processor::fuseInstructions(const Instruction& first, const Instruction& second, Instruction& fused) const {
+    int rd = first.rd;
+    if (first.fusion != FUSE_NONE || rd <= 0 || second.rd != rd) return false;
+
+    fused = first;
+    if (first.opcode == ADD && second.opcode >= LB && second.opcode <= LHU && second.rs1 == rd) {
+        // Address rs1 + rs2 + imm, loaded with the width of the load.
+        fused.fusion = FUSE_INDEXED_LOAD;
+        fused.opcode = second.opcode;
+        fused.immediate = second.immediate;
+    } else if (first.opcode == LUI && second.opcode == ADDI && second.rs1 == rd) {
+        fused.fusion = FUSE_LOAD_IMMEDIATE;
+        fused.immediate = first.immediate + second.immediate;
+    } else if (first.opcode == AUIPC && second.opcode == ADDI && second.rs1 == rd) {
+        fused.fusion = FUSE_PC_RELATIVE;
+        fused.immediate = first.immediate + second.immediate;
+    } else if (first.opcode == SLLI && second.opcode == ADD &&
+               (second.rs1 == rd) != (second.rs2 == rd)) {
+        // (rs1 << imm) + rs2
+        fused.fusion = FUSE_SHIFT_ADD;
+        fused.opcode = ADD;
+        fused.format = R_TYPE;
+        fused.rs2 = second.rs1 == rd ? second.rs2 : second.rs1;
+        fused.immediate = first.immediate & 0x1F;
+    } else if (first.opcode == SLLI && second.opcode == SRLI && second.rs1 == rd) {
+        // (rs1 << (imm & 31)) >> (imm >> 5), logical
+        fused.fusion = FUSE_ZERO_EXTEND;
+        fused.opcode = SRLI;
+        fused.rs2 = 0;
+        fused.immediate = (first.immediate & 0x1F) | ((second.immediate & 0x1F) << 5);
+    } else {
+        return false;
+    }
+
+    return (core.fusionIdioms & (1u << fused.fusion)) != 0;
+}
+
+void Processor::printTerminalTrace(std::ostream& out) const {
+    out << "+-----------+-----------------+";
+    for (int i = 1; i <= clockCycle; i++) out << "-----+";
+    out << "\n";
+
+    out << "| PC        |   Instruction   |";
+    for (int i = 1; i <= clockCycle; i++) out << " C" << std::setw(2) << i << " |";
+    out << "\n";
+
+    out << "+-----------+-----------------+";
+    for (int i = 1; i <= clockCycle; i++) out << "-----+";
+    out << "\n";
+
+    for (const InstructionTrace* row : instructionTracesByAddress()) {
+        const InstructionTrace& trace = *row;
+        out << "| 0x" << std::hex << std::setw(8) << std::left << trace.address
+                   << "| " << std::setw(15) << std::left << trace.disassembly << " |";
+
+        for (int i = 0; i < clockCycle; i++) {
+            std::string stage = "-";
+            if (static_cast<size_t>(i) < trace.stages.size()) stage = trace.stages[i];
+            out << " " << std::setw(3) << std::left << stage << " |";
+        }
+        out << "\n";
+    }
+
+    out << "+-----------+-----------------+";
+    for (int i = 1; i <= clockCycle; i++) out << "-----+";
+    out << "\n" << std::dec;
+}
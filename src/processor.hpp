@@ -0,0 +1,908 @@
+#ifndef PROCESSOR_HPP
+#define PROCESSOR_HPP
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+enum InstructionFormat {
+    R_TYPE, I_TYPE, S_TYPE, B_TYPE, U_TYPE, J_TYPE
+};
+
+enum Opcode {
+    // R-type
+    ADD = 0, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND,
+    // I-type
+    ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI, LB, LH, LW, LBU, LHU,
+    // S-type
+    SB, SH, SW,
+    // B-type
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    // U-type
+    LUI, AUIPC,
+    // J-type
+    JAL, JALR,
+    // Invalid
+    INVALID
+};
+
+extern const std::map<Opcode, std::string> opcodeToString;
+
+// Pairs of adjacent instructions that ID can issue as one internal op.  In
+// each idiom the second instruction overwrites the register the first one
+// writes, so the intermediate value never needs to exist:
+//
+//   FUSE_INDEXED_LOAD   add rd, rs1, rs2   + l{b,h,w}[u] rd, imm(rd)
+//   FUSE_LOAD_IMMEDIATE lui rd, hi         + addi rd, rd, lo
+//   FUSE_PC_RELATIVE    auipc rd, hi       + addi rd, rd, lo
+//   FUSE_SHIFT_ADD      slli rd, rs1, sh   + add rd, rd, rs2
+//   FUSE_ZERO_EXTEND    slli rd, rs1, n    + srli rd, rd, m
+enum FusionKind {
+    FUSE_NONE, FUSE_INDEXED_LOAD, FUSE_LOAD_IMMEDIATE, FUSE_PC_RELATIVE, FUSE_SHIFT_ADD,
+    FUSE_ZERO_EXTEND, FUSION_KIND_COUNT
+};
+
+extern const char* const fusionKindNames[FUSION_KIND_COUNT];
+
+struct Instruction {
+    uint32_t raw;
+    Opcode opcode;
+    InstructionFormat format;
+    int rs1, rs2, rd;
+    int32_t immediate;
+    int length;   // 2 for a compressed (RVC) instruction, otherwise 4
+
+    // A fused op keeps the PC, raw word and length of its first instruction;
+    // the second one starts at pc + length.
+    FusionKind fusion;
+
+    Instruction() : raw(0), opcode(INVALID), format(R_TYPE), rs1(-1), rs2(-1), rd(-1), immediate(0), length(4),
+                    fusion(FUSE_NONE) {}
+};
+
+struct ControlSignals {
+    bool regWrite, memRead, memWrite, memToReg, aluSrc, branch, jump;
+    int aluOp;
+
+    ControlSignals() : regWrite(false), memRead(false), memWrite(false),
+                        memToReg(false), aluSrc(false), branch(false),
+                        jump(false), aluOp(0) {}
+};
+
+struct ALUResult {
+    int32_t result;
+    bool zero, negative, overflow;
+
+    ALUResult() : result(0), zero(false), negative(false), overflow(false) {}
+};
+
+// Why a latch is empty.  A bubble keeps its cause and the PC responsible for
+// it as it moves down the pipeline, so every empty WB slot can be explained.
+// The memory and structural causes are not produced by the current pipeline,
+// whose memory is single-cycle and whose stages share no resources.  A value
+// mispredict bubble is charged to the load whose predicted value was wrong.
+enum BubbleCause {
+    BUBBLE_FILL, BUBBLE_FETCH_STARVED, BUBBLE_BRANCH_FLUSH, BUBBLE_VALUE_MISPREDICT, BUBBLE_DATA_HAZARD,
+    BUBBLE_MEMORY, BUBBLE_STRUCTURAL, BUBBLE_CAUSE_COUNT
+};
+
+struct Bubble {
+    BubbleCause cause;
+    uint32_t pc;
+
+    Bubble() : cause(BUBBLE_FILL), pc(0) {}
+    Bubble(BubbleCause cause, uint32_t pc) : cause(cause), pc(pc) {}
+};
+
+struct IF_ID_Register {
+    uint32_t pc;
+    Instruction instruction;
+    bool valid;
+    Bubble bubble;
+
+    IF_ID_Register() : pc(0), valid(false) {}
+};
+
+struct ID_EX_Register {
+    uint32_t pc;
+    Instruction instruction;
+    int32_t readData1, readData2, immediate;
+    ControlSignals control;
+    bool valid;
+    Bubble bubble;
+
+    // A load whose value ID predicted; consumers run ahead with the
+    // prediction until MEM checks it.
+    bool valuePredicted;
+    int32_t predictedValue;
+
+    // Position of the instruction in the execution trace being replayed.
+    size_t replayIndex;
+
+    ID_EX_Register() : pc(0), readData1(0), readData2(0), immediate(0), valid(false), valuePredicted(false),
+                       predictedValue(0), replayIndex(0) {}
+};
+
+struct EX_MEM_Register {
+    uint32_t pc, branchTarget;
+    Instruction instruction;
+    ALUResult aluResult;
+    int32_t readData2;
+    int32_t loadData;   // loaded value when the load accessed memory in EX
+    ControlSignals control;
+    bool branchTaken, valid;
+    Bubble bubble;
+    bool valuePredicted;
+    int32_t predictedValue;
+    size_t replayIndex;
+
+    EX_MEM_Register() : pc(0), branchTarget(0), readData2(0), loadData(0),
+                    branchTaken(false), valid(false), valuePredicted(false), predictedValue(0), replayIndex(0) {}
+};
+
+struct MEM_WB_Register {
+    uint32_t pc;
+    Instruction instruction;
+    int32_t aluResult, readData;
+    ControlSignals control;
+    bool valid;
+    Bubble bubble;
+
+    MEM_WB_Register() : pc(0), aluResult(0), readData(0), valid(false) {}
+};
+
+// Instruction memory as 16-bit parcels in address order.  Programs may mix
+// compressed (RVC) and 32-bit instructions, so an instruction starts on any
+// halfword and a 32-bit one may straddle two aligned words.
+struct InstructionMemory {
+    std::vector<uint16_t> parcels;
+
+    static bool isCompressed(uint32_t raw) { return (raw & 3) != 3; }
+
+    uint32_t size() const { return parcels.size() * 2; }
+
+    bool contains(uint32_t address) const {
+        return address / 2 < parcels.size();
+    }
+
+    uint16_t readParcel(uint32_t address) const {
+        return address / 2 < parcels.size() ? parcels[address / 2] : 0;
+    }
+
+    // The instruction starting at `address`: a compressed one is returned in
+    // the low half, a 32-bit one whole.
+    uint32_t readInstruction(uint32_t address) const {
+        uint32_t low = readParcel(address);
+        if (isCompressed(low)) return low;
+        return low | (static_cast<uint32_t>(readParcel(address + 2)) << 16);
+    }
+
+    void appendWord(uint32_t word) {
+        parcels.push_back(word & 0xFFFF);
+        parcels.push_back(word >> 16);
+    }
+
+    void appendParcel(uint16_t parcel) { parcels.push_back(parcel); }
+};
+
+// One retired instruction of a recorded execution: where it ran, the data
+// address it accessed and the value it loaded, and where control went next
+// when that was not the following instruction.  A fused pair is recorded as
+// its two instructions.
+struct TraceRecord {
+    enum Flags { TAKEN = 1, LOAD = 2, STORE = 4 };
+
+    uint32_t pc;
+    uint32_t address;   // loads and stores
+    int32_t value;      // loads, and stores when executed live (files leave it 0)
+    uint32_t target;    // taken control transfers
+    uint8_t flags;
+
+    TraceRecord() : pc(0), address(0), value(0), target(0), flags(0) {}
+
+    bool taken() const { return flags & TAKEN; }
+};
+
+// The dynamic instruction stream of one run together with the program it
+// came from, enough to replay the run's timing without executing it.
+struct ExecutionTrace {
+    InstructionMemory program;
+    std::vector<TraceRecord> records;
+};
+
+// Where a timing-only replay takes its records from.  Records are numbered
+// from 0 in retirement order.  ID asks for each one as its instruction
+// arrives, and MEM releases them once nothing behind can ask for them again.
+class TraceSource {
+public:
+    virtual ~TraceSource() {}
+
+    // The record at `index`, or nullptr when the stream ends before it.
+    virtual const TraceRecord* record(size_t index) = 0;
+
+    // Records before `index` are no longer needed.
+    virtual void release(size_t index) {}
+};
+
+// Replays an ExecutionTrace held in memory.
+class StoredTraceSource : public TraceSource {
+public:
+    explicit StoredTraceSource(std::shared_ptr<const ExecutionTrace> trace) : trace_(trace) {}
+
+    const TraceRecord* record(size_t index) override {
+        return index < trace_->records.size() ? &trace_->records[index] : nullptr;
+    }
+
+private:
+    std::shared_ptr<const ExecutionTrace> trace_;
+};
+
+// Parcels fetched from instruction memory but not yet handed to IF/ID.  Each
+// cycle the fetch unit reads at most one aligned 32-bit word into the buffer,
+// and only while the word fits.  The buffer lets a 32-bit instruction that
+// straddles two words issue without a fetch bubble, and stops fetching when
+// compressed code has filled it.
+struct FetchBuffer {
+    static const int kCapacity = 4;   // parcels
+
+    uint32_t pc;   // address of parcels[0]
+    uint16_t parcels[kCapacity];
+    int count;
+
+    FetchBuffer() : pc(0), parcels(), count(0) {}
+
+    bool hasInstruction() const {
+        return count > 0 && (InstructionMemory::isCompressed(parcels[0]) || count > 1);
+    }
+
+    void flush(uint32_t address) { pc = address; count = 0; }
+};
+
+struct RegisterFile {
+    int32_t registers[32];
+
+    RegisterFile() {
+        for (int i = 0; i < 32; i++) registers[i] = 0;
+    }
+
+    int32_t read(int reg) const {
+        if (reg >= 0 && reg < 32) return registers[reg];
+        return 0;
+    }
+
+    void write(int reg, int32_t value) {
+        if (reg > 0 && reg < 32) registers[reg] = value;
+    }
+};
+
+// Byte-addressed data memory stored as fixed-size pages.  Pages are shared
+// between copies of the memory and only duplicated when one side writes to
+// them, so taking a snapshot costs one pointer per page.
+struct DataMemory {
+    static const uint32_t kPageBits = 8;
+    static const uint32_t kPageSize = 1u << kPageBits;
+
+    typedef std::vector<uint8_t> Page;
+
+    std::vector<std::shared_ptr<Page> > pages;
+    size_t memorySize;
+
+    DataMemory(size_t size = 1024) : memorySize(size) {
+        size_t pageCount = (size + kPageSize - 1) / kPageSize;
+        std::shared_ptr<Page> zeroPage = std::make_shared<Page>(kPageSize, 0);
+        pages.assign(pageCount, zeroPage);
+    }
+
+    size_t size() const { return memorySize; }
+
+    uint8_t readByte(uint32_t address) const {
+        return (*pages[address >> kPageBits])[address & (kPageSize - 1)];
+    }
+
+    void writeByte(uint32_t address, uint8_t value) {
+        std::shared_ptr<Page>& page = pages[address >> kPageBits];
+        if (page.use_count() > 1) page = std::make_shared<Page>(*page);
+        (*page)[address & (kPageSize - 1)] = value;
+    }
+
+    int32_t read(uint32_t address, int size) const {
+        if (address + size - 1 < memorySize) {
+            int32_t value = 0;
+            for (int i = 0; i < size; i++) {
+                value |= (static_cast<int32_t>(readByte(address + i)) << (i * 8));
+            }
+            return value;
+        }
+        return 0;
+    }
+
+    void write(uint32_t address, int32_t value, int size) {
+        if (address + size - 1 < memorySize) {
+            for (int i = 0; i < size; i++) {
+                writeByte(address + i, (value >> (i * 8)) & 0xFF);
+            }
+        }
+    }
+};
+
+struct ForwardingUnit {
+    enum ForwardSource {
+        FROM_REG = 0, FROM_EX_MEM, FROM_MEM_WB
+    };
+
+    ForwardSource forwardA, forwardB;
+
+    ForwardingUnit() : forwardA(FROM_REG), forwardB(FROM_REG) {}
+
+    void detectForwarding(const ID_EX_Register& idEx,
+                         const EX_MEM_Register& exMem,
+                         const MEM_WB_Register& memWb) {
+        forwardA = FROM_REG;
+        forwardB = FROM_REG;
+
+        if (!idEx.valid) return;
+
+        if (idEx.instruction.rs1 != 0) {
+            if (exMem.valid && exMem.control.regWrite &&
+                exMem.instruction.rd != 0 &&
+                exMem.instruction.rd == idEx.instruction.rs1) {
+                forwardA = FROM_EX_MEM;
+            } else if (memWb.valid && memWb.control.regWrite &&
+                    memWb.instruction.rd != 0 &&
+                    memWb.instruction.rd == idEx.instruction.rs1) {
+                forwardA = FROM_MEM_WB;
+            }
+        }
+
+        if (idEx.instruction.rs2 != 0) {
+            if (exMem.valid && exMem.control.regWrite &&
+                exMem.instruction.rd != 0 &&
+                exMem.instruction.rd == idEx.instruction.rs2) {
+                forwardB = FROM_EX_MEM;
+            } else if (memWb.valid && memWb.control.regWrite &&
+                    memWb.instruction.rd != 0 &&
+                    memWb.instruction.rd == idEx.instruction.rs2) {
+                forwardB = FROM_MEM_WB;
+            }
+        }
+    }
+};
+
+// Source registers an instruction actually reads: U- and J-type have no
+// rs1, and only R-, B- and S-type read rs2.  x0 is never a dependency.
+inline bool readsRs1(const Instruction& inst) {
+    return inst.rs1 > 0 && inst.format != U_TYPE && inst.format != J_TYPE;
+}
+
+inline bool readsRs2(const Instruction& inst) {
+    return inst.rs2 > 0 && (inst.format == R_TYPE || inst.format == B_TYPE || inst.format == S_TYPE);
+}
+
+struct HazardDetectionUnit {
+    // Load-to-use timing, set from CoreConfig by configure().
+    int loadUseLatency;
+    bool earlyLoadAddress;
+
+    // For each register written by a load still in flight, the first cycle in
+    // which ID may pass on an instruction that reads it in EX; 0 when the
+    // latest writer of the register is not a load.  Readers that need the
+    // value in ID (branches, and loads that generate their address there) wait
+    // one cycle more under forwarding.
+    int loadReadyCycle[32];
+
+    HazardDetectionUnit() : loadUseLatency(1), earlyLoadAddress(false), loadReadyCycle() {}
+
+    void configure(int latency, bool early) {
+        loadUseLatency = latency > 0 ? latency : 1;
+        earlyLoadAddress = early;
+        clear();
+    }
+
+    void clear() {
+        for (int i = 0; i < 32; i++) loadReadyCycle[i] = 0;
+    }
+
+    // The load writing `reg` had its value predicted in ID.
+    void markReady(int reg) { loadReadyCycle[reg] = 0; }
+
+    static bool isLoad(const Instruction& inst) {
+        return inst.opcode >= LB && inst.opcode <= LHU;
+    }
+
+    // Instructions that need their operands in ID rather than in EX.
+    bool readsOperandsInID(const Instruction& inst) const {
+        return inst.format == B_TYPE || inst.format == J_TYPE || inst.opcode == JALR ||
+               (earlyLoadAddress && isLoad(inst));
+    }
+
+    // Called when ID passes `inst` on to EX in `cycle`.  A load's value can
+    // be forwarded to EX `loadUseLatency` cycles after it leaves MEM, or one
+    // cycle earlier when the load generated its address in ID and accessed
+    // memory in EX.  Without forwarding it is read from the register file
+    // once the load has written back.
+    void recordDecode(const Instruction& inst, const ControlSignals& control, int cycle, bool isForwarding) {
+        if (!control.regWrite || inst.rd <= 0) return;
+        if (!control.memRead) {
+            loadReadyCycle[inst.rd] = 0;
+        } else if (isForwarding) {
+            loadReadyCycle[inst.rd] = cycle + 1 + loadUseLatency - (earlyLoadAddress ? 1 : 0);
+        } else {
+            loadReadyCycle[inst.rd] = cycle + 2 + loadUseLatency;
+        }
+    }
+
+    // True when the instruction in IF/ID must wait in `cycle` for a load in
+    // flight, either for the loaded value or, with early address generation,
+    // because it is a load whose base register the instruction in EX is
+    // still computing.
+    bool detectLoadHazard(const IF_ID_Register& ifId, const ID_EX_Register& idEx, int cycle,
+                          bool isForwarding) const {
+        if (!ifId.valid) return false;
+
+        const Instruction& inst = ifId.instruction;
+        bool usesRs1 = readsRs1(inst);
+        bool usesRs2 = readsRs2(inst);
+        int wait = isForwarding && readsOperandsInID(inst) ? 1 : 0;
+
+        if (usesRs1 && loadReadyCycle[inst.rs1] && cycle < loadReadyCycle[inst.rs1] + wait) return true;
+        if (usesRs2 && loadReadyCycle[inst.rs2] && cycle < loadReadyCycle[inst.rs2] + wait) return true;
+
+        return isForwarding && earlyLoadAddress && isLoad(inst) && usesRs1 && idEx.valid &&
+               idEx.control.regWrite && idEx.instruction.rd == inst.rs1;
+    }
+
+    bool detectHazardF(const IF_ID_Register& ifId, const ID_EX_Register& idEx,
+                     const EX_MEM_Register& exMem, const MEM_WB_Register& memWb,
+                     bool isForwarding, int cycle, bool isIFStage = false) {
+        if (!ifId.valid) return false;
+
+        int rs1 = ifId.instruction.rs1;
+        int rs2 = ifId.instruction.rs2;
+
+        bool usesRs1 = readsRs1(ifId.instruction);
+        bool usesRs2 = readsRs2(ifId.instruction);
+
+        bool isBranchOrJump = (ifId.instruction.format == B_TYPE ||
+                              ifId.instruction.format == J_TYPE ||
+                              (ifId.instruction.format == I_TYPE && ifId.instruction.opcode == JALR));
+
+        if (isIFStage && !isBranchOrJump) return false;
+
+        if (detectLoadHazard(ifId, idEx, cycle, isForwarding)) return true;
+
+        if (isForwarding) return false;
+
+        if (idEx.valid && idEx.control.regWrite && idEx.instruction.rd != 0) {
+            if ((usesRs1 && rs1 == idEx.instruction.rd) ||
+                (usesRs2 && rs2 == idEx.instruction.rd)) {
+                return true;
+            }
+        }
+
+        if (exMem.valid && exMem.control.regWrite && exMem.instruction.rd != 0) {
+            if ((usesRs1 && rs1 == exMem.instruction.rd) ||
+                (usesRs2 && rs2 == exMem.instruction.rd)) {
+                return true;
+            }
+        }
+
+        if (memWb.valid && memWb.control.regWrite && memWb.instruction.rd != 0) {
+            if ((usesRs1 && rs1 == memWb.instruction.rd) ||
+                (usesRs2 && rs2 == memWb.instruction.rd)) {
+                if (!isIFStage) return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+// Direct-mapped instruction cache in front of instruction memory.  Only the
+// tags are modelled; a miss makes the fetch unit wait for the line.
+struct InstructionCache {
+    uint32_t lineSize;
+    std::vector<uint32_t> tags;   // line address + 1 per set, 0 when empty
+
+    InstructionCache() : lineSize(16) {}
+
+    void configure(uint32_t size, uint32_t line) {
+        lineSize = line ? line : 4;
+        tags.assign(size / lineSize, 0);
+    }
+
+    bool enabled() const { return !tags.empty(); }
+
+    // Returns true on a hit; a miss installs the line.
+    bool access(uint32_t address) {
+        uint32_t line = address / lineSize;
+        uint32_t& tag = tags[line % tags.size()];
+        if (tag == line + 1) return true;
+        tag = line + 1;
+        return false;
+    }
+};
+
+// Decoded instructions of one short loop closed by a backward branch or
+// jump.  A taken backward branch arms capture from its target; the fetch
+// unit records what it fetches from there, and once the closing branch is
+// recorded the loop is replayed from the buffer instead of from the fetch
+// unit and decoder, with the loop head following the closing branch
+// directly.  Any other redirect ends the replay but keeps the captured loop,
+// so the next taken closing branch resumes it.
+struct LoopBuffer {
+    enum Mode { LOOP_IDLE, LOOP_CAPTURING, LOOP_REPLAYING };
+
+    size_t capacity;
+    Mode mode;
+    uint32_t start, branchPc;
+    bool complete;
+    std::vector<IF_ID_Register> entries;
+    size_t next;
+
+    LoopBuffer() : capacity(0), mode(LOOP_IDLE), start(0), branchPc(0), complete(false), next(0) {}
+
+    void configure(size_t size) {
+        capacity = size;
+        mode = LOOP_IDLE;
+        complete = false;
+        entries.clear();
+        next = 0;
+    }
+
+    bool enabled() const { return capacity > 0; }
+    bool replaying() const { return mode == LOOP_REPLAYING; }
+
+    void stop() {
+        mode = LOOP_IDLE;
+        if (!complete) entries.clear();
+    }
+
+    // The branch at `pc` was taken back to `target`.  Returns true when the
+    // loop was already captured and replay restarts at its head.
+    bool takenBackward(uint32_t pc, uint32_t target) {
+        if (complete && start == target && branchPc == pc) {
+            mode = LOOP_REPLAYING;
+            next = 0;
+            return true;
+        }
+        mode = LOOP_CAPTURING;
+        start = target;
+        branchPc = pc;
+        complete = false;
+        entries.clear();
+        return false;
+    }
+
+    // Records an instruction the fetch unit delivered while capturing.
+    void capture(const IF_ID_Register& fetched) {
+        if (mode != LOOP_CAPTURING) return;
+        uint32_t expected = entries.empty() ? start : entries.back().pc + entries.back().instruction.length;
+        if (fetched.pc != expected || entries.size() == capacity) {
+            mode = LOOP_IDLE;
+            entries.clear();
+            return;
+        }
+        entries.push_back(fetched);
+        if (fetched.pc == branchPc) {
+            complete = true;
+            mode = LOOP_REPLAYING;
+            next = 0;
+        }
+    }
+
+    // The next instruction of the loop, wrapping from the closing branch to
+    // the head.
+    const IF_ID_Register& replay() {
+        const IF_ID_Register& entry = entries[next];
+        next = (next + 1) % entries.size();
+        return entry;
+    }
+
+    uint32_t nextPc() const { return entries[next].pc; }
+};
+
+// PC-indexed table of recent load behaviour, consulted in ID.  Each entry
+// keeps the last value and address of one static load, the strides between
+// its last two values and addresses, and a 2-bit confidence counter for each
+// prediction.  Entries are trained when the load reaches MEM, so an instance
+// decoded while an older one is still in flight sees the older state.
+struct LoadPredictor {
+    struct Entry {
+        uint32_t tag;   // pc + 1, 0 when empty
+        int32_t lastValue, valueStride;
+        uint32_t lastAddress;
+        int32_t addressStride;
+        int valueConfidence, addressConfidence;
+    };
+
+    static const int kConfident = 2;
+
+    std::vector<Entry> entries;
+    bool strideValues;
+
+    LoadPredictor() : strideValues(false) {}
+
+    void configure(size_t size, bool stride) {
+        entries.assign(size, Entry());
+        strideValues = stride;
+    }
+
+    bool enabled() const { return !entries.empty(); }
+
+    const Entry* lookup(uint32_t pc) const {
+        const Entry& entry = entries[(pc / 2) % entries.size()];
+        return entry.tag == pc + 1 ? &entry : nullptr;
+    }
+
+    bool predictValue(uint32_t pc, int32_t& value) const {
+        const Entry* entry = lookup(pc);
+        if (!entry || entry->valueConfidence < kConfident) return false;
+        value = entry->lastValue + (strideValues ? entry->valueStride : 0);
+        return true;
+    }
+
+    bool predictAddress(uint32_t pc, uint32_t& address) const {
+        const Entry* entry = lookup(pc);
+        if (!entry || entry->addressConfidence < kConfident) return false;
+        address = entry->lastAddress + entry->addressStride;
+        return true;
+    }
+
+    void train(uint32_t pc, uint32_t address, int32_t value) {
+        Entry& entry = entries[(pc / 2) % entries.size()];
+        if (entry.tag != pc + 1) {
+            entry = Entry();
+            entry.tag = pc + 1;
+            entry.lastValue = value;
+            entry.lastAddress = address;
+            return;
+        }
+
+        int32_t expected = entry.lastValue + (strideValues ? entry.valueStride : 0);
+        entry.valueConfidence = value == expected ? std::min(entry.valueConfidence + 1, 3) : 0;
+        entry.addressConfidence = address == entry.lastAddress + entry.addressStride
+                                      ? std::min(entry.addressConfidence + 1, 3) : 0;
+        entry.valueStride = value - entry.lastValue;
+        entry.addressStride = address - entry.lastAddress;
+        entry.lastValue = value;
+        entry.lastAddress = address;
+    }
+};
+
+enum LoadValuePrediction {
+    LOAD_PREDICT_NONE, LOAD_PREDICT_LAST_VALUE, LOAD_PREDICT_STRIDE
+};
+
+// Microarchitectural parameters.  The defaults describe the original
+// five-stage pipeline.  A new field must also be added to configHash().
+struct CoreConfig {
+    // Decoded instructions the fetch unit may run ahead of ID.  With 0, fetch
+    // writes IF/ID directly and stops whenever ID stalls.
+    int fetchQueueDepth;
+
+    // Instruction cache size in bytes; 0 models an ideal instruction memory.
+    uint32_t icacheSize, icacheLineSize;
+    int icacheMissLatency;
+
+    // Cycles a load's value takes to reach an ALU consumer under forwarding:
+    // with 1 an immediately dependent instruction waits one bubble, and each
+    // extra cycle models a slower data memory.  With earlyLoadAddress loads
+    // generate their address in ID and access memory in EX, which hides one
+    // cycle of that latency but makes a load wait when the instruction just
+    // ahead of it computes its base register.
+    int loadUseLatency;
+    bool earlyLoadAddress;
+
+    // Bit (1 << kind) enables each FusionKind in ID.  The second instruction
+    // of a pair comes from the fetch queue, or straight from the fetch unit
+    // when the queue is empty, so a fused pair leaves the frontend in one
+    // cycle.
+    unsigned fusionIdioms;
+
+    // Load speculation under forwarding.  A value predictor guesses what a
+    // load returns; an address predictor guesses where it reads, and ID reads
+    // memory there.  Either way the load's consumers proceed at once, and a
+    // wrong value found in MEM squashes everything behind the load.
+    LoadValuePrediction loadValuePrediction;
+    bool loadAddressPrediction;
+    int loadPredictorEntries;
+
+    // Instructions the loop buffer holds; 0 disables it.  Loops longer than
+    // this are fetched normally.
+    int loopBufferSize;
+
+    CoreConfig() : fetchQueueDepth(0), icacheSize(0), icacheLineSize(16), icacheMissLatency(10),
+                   loadUseLatency(1), earlyLoadAddress(false), fusionIdioms(0),
+                   loadValuePrediction(LOAD_PREDICT_NONE), loadAddressPrediction(false),
+                   loadPredictorEntries(64), loopBufferSize(0) {}
+};
+
+class PipelineObserver;
+
+// Per-cycle machine state outside the register file and data memory: the PC,
+// the pipeline latches and the running counters.  Processor holds it as its
+// base, so saving or restoring it is a single assignment and a new field or
+// counter is declared, reset and checkpointed here alone.
+struct PipelineState {
+    uint32_t pc;
+
+    IF_ID_Register ifId;
+    ID_EX_Register idEx;
+    EX_MEM_Register exMem;
+    MEM_WB_Register memWb;
+    FetchBuffer fetchBuffer;
+
+    // Instructions fetched ahead of ID when core.fetchQueueDepth > 0, and the
+    // instruction cache with the cycle its outstanding miss completes.
+    std::deque<IF_ID_Register> fetchQueue;
+    InstructionCache icache;
+    int icacheReadyCycle;
+
+    HazardDetectionUnit hazardUnit;
+
+    int clockCycle, instructionsExecuted;
+    int stallCycles, branchFlushes;
+
+    // Stall cycles spent waiting for a load, including address interlocks
+    // with early address generation.
+    int loadUseStalls;
+
+    // Pairs issued as one op, per FusionKind (FUSE_NONE unused).
+    int fusedPairs[FUSION_KIND_COUNT];
+
+    // Load value speculation: loads that reached MEM, predictions made by the
+    // value and by the address predictor, and predictions MEM found wrong.
+    LoadPredictor loadPredictor;
+    int loadsExecuted, loadValuePredictions, loadAddressPredictions, loadMispredicts;
+
+    // Aligned words read by the fetch unit, and the instructions (all, and
+    // compressed ones) it delivered to IF/ID.
+    int fetchWords, instructionsFetched, compressedFetched;
+
+    // Cycles ID could take an instruction but fetch had none, instruction
+    // cache activity, and how many cycles the fetch queue held each number of
+    // instructions.
+    int fetchStarvedCycles, icacheAccesses, icacheMisses;
+    std::vector<uint64_t> fetchQueueOccupancy;
+
+    // Instructions delivered by the loop buffer, each saving a fetch and a
+    // decode, and taken closing branches that found the loop head already
+    // behind them instead of flushing.
+    LoopBuffer loopBuffer;
+    int loopBufferReplays, loopFlushesAvoided;
+
+    // Position in a replayed trace (see Processor::replaySource).
+    // replayCursor is the record of the next instruction to leave ID.  ID
+    // sets replayEnded when the trace has no records left for IF/ID, and
+    // replayDiverged as well when its record is for another PC; either way
+    // the pipeline drains.
+    size_t replayCursor;
+    bool replayEnded, replayDiverged;
+
+    PipelineState() : pc(0), icacheReadyCycle(0), clockCycle(0), instructionsExecuted(0), stallCycles(0),
+                      branchFlushes(0), loadUseStalls(0), fusedPairs(), loadsExecuted(0), loadValuePredictions(0),
+                      loadAddressPredictions(0), loadMispredicts(0), fetchWords(0), instructionsFetched(0),
+                      compressedFetched(0), fetchStarvedCycles(0), icacheAccesses(0), icacheMisses(0),
+                      loopBufferReplays(0), loopFlushesAvoided(0), replayCursor(0), replayEnded(false),
+                      replayDiverged(false) {}
+};
+
+// Everything a Processor needs to resume from a given cycle.  The data memory
+// pages are shared with the live processor until either side writes to them,
+// so a snapshot is cheap to take and to keep around.
+struct ProcessorSnapshot {
+    PipelineState pipeline;
+    RegisterFile regFile;
+    DataMemory dataMem;
+};
+
+struct Processor : PipelineState {
+    CoreConfig core;
+    InstructionMemory instMem;
+    RegisterFile regFile;
+    DataMemory dataMem;
+    ForwardingUnit forwardUnit;
+
+    // Timing-only replay of a recorded execution when set: ID takes branch
+    // outcomes from the trace, EX and MEM take addresses and loaded values
+    // from it, and nothing is computed or written back.
+    TraceSource* replaySource;
+
+    // When false the per-instruction stage table below is not maintained,
+    // which keeps harness runs free of the trace lookups.
+    bool traceEnabled;
+
+    // External tools hooked into the stages, and their request to pause the
+    // run at the end of the current cycle.
+    std::vector<PipelineObserver*> observers;
+    bool stopRequested;
+
+    struct InstructionTrace {
+        uint32_t address;
+        uint32_t raw;
+        std::string disassembly;
+        std::vector<std::string> stages;
+    };
+
+    // Rows are created, and their disassembly formatted, the first time a PC
+    // reaches a stage, so words that never enter the pipeline cost nothing.
+    // traceRows maps each halfword of instruction memory to its row, or -1.
+    std::vector<InstructionTrace> instructionTraces;
+    std::vector<int> traceRows;
+
+    Processor() : replaySource(nullptr), traceEnabled(true), stopRequested(false) {}
+
+    void reset() {
+        static_cast<PipelineState&>(*this) = PipelineState();
+        stopRequested = false;
+        icache.configure(core.icacheSize, core.icacheLineSize);
+        hazardUnit.configure(core.loadUseLatency, core.earlyLoadAddress);
+        bool predictLoads = core.loadValuePrediction != LOAD_PREDICT_NONE || core.loadAddressPrediction;
+        loadPredictor.configure(predictLoads ? core.loadPredictorEntries : 0,
+                                core.loadValuePrediction == LOAD_PREDICT_STRIDE);
+        fetchQueueOccupancy.assign(core.fetchQueueDepth + 1, 0);
+        loopBuffer.configure(core.loopBufferSize);
+    }
+
+    // The pipeline has drained and the PC has run off the end of the program,
+    // or past the end of the trace being replayed.
+    bool halted() const {
+        bool fetchDone = replayEnded || (!instMem.contains(pc) && fetchQueue.empty() && !ifId.valid);
+        return fetchDone && !idEx.valid && !exMem.valid && !memWb.valid;
+    }
+
+    int findInstructionTrace(uint32_t address) const {
+        size_t slot = address / 2;
+        return slot < traceRows.size() ? traceRows[slot] : -1;
+    }
+
+    void clearInstructionTraces() {
+        instructionTraces.clear();
+        traceRows.clear();
+    }
+
+    // Rows in address order, the order the stage table is printed in.
+    std::vector<const InstructionTrace*> instructionTracesByAddress() const;
+
+    void savePipelineState(PipelineState& state) const;
+    void restorePipelineState(const PipelineState& state);
+    void saveSnapshot(ProcessorSnapshot& snapshot) const;
+    void restoreSnapshot(const ProcessorSnapshot& snapshot);
+
+    // Returns the row for the instruction at `pc`, creating it on first use;
+    // -1 when `pc` is outside instruction memory.
+    int initInstructionTrace(uint32_t pc);
+    void trackInstructionStage(int instructionIndex, int cycle, const std::string& stage);
+    void trackStage(uint32_t address, const std::string& stage) {
+        if (!traceEnabled) return;
+        int instIndex = findInstructionTrace(address);
+        if (instIndex < 0) instIndex = initInstructionTrace(address);
+        if (instIndex >= 0) trackInstructionStage(instIndex, clockCycle - 1, stage);
+    }
+
+    // Marks both halves of a fused op.
+    void trackStage(uint32_t address, const Instruction& inst, const std::string& stage) {
+        trackStage(address, stage);
+        if (inst.fusion != FUSE_NONE) trackStage(address + inst.length, stage);
+    }
+
+    void outputPipelineTraceCSV(std::ostream& out) const;
+    void outputPipelineTraceTXT(std::ostream& out) const;
+    void printTraceHeader(std::ostream& out) const;
+    void printTrace(std::ostream& out) const;
+    void printTerminalTrace(std::ostream& out) const;
+
+    void decodeInstruction(uint32_t rawInst, Instruction& inst) const;
+    void setControlSignals(const Instruction& inst, ControlSignals& control) const;
+
+    // Builds the op `first` and `second` fuse into when they form one of the
+    // enabled idioms.
+    bool fuseInstructions(const Instruction& first, const Instruction& second, Instruction& fused) const;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "resultcache.hpp"
+#include "byteorder.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint32_t kFormatVersion = 1;
+
+// The statistics stored in an entry, in file order.  New fields go at the
+// end; an entry with a different count is treated as a miss.
+static uint64_t SimulatorStats::* const kStatFields[] = {
+    &SimulatorStats::cycles, &SimulatorStats::instructionsRetired, &SimulatorStats::stallCycles,
+    &SimulatorStats::branchFlushes, &SimulatorStats::loadUseStalls, &SimulatorStats::fusedPairs,
+    &SimulatorStats::loadsExecuted, &SimulatorStats::loadPredictions, &SimulatorStats::loadMispredicts,
+    &SimulatorStats::fetchWords, &SimulatorStats::instructionsFetched, &SimulatorStats::compressedFetched,
+    &SimulatorStats::fetchStarvedCycles, &SimulatorStats::icacheAccesses, &SimulatorStats::icacheMisses,
+    &SimulatorStats::loopBufferReplays, &SimulatorStats::loopFlushesAvoided,
+};
+static const uint32_t kStatCount = sizeof(kStatFields) / sizeof(kStatFields[0]);
+
+void CachedResult::release() {
+    if (mapping_) munmap(mapping_, size_);
+    mapping_ = nullptr;
+    size_ = 0;
+    stats_ = SimulatorStats();
+    traces_.clear();
+}
+
+uint64_t ResultCache::key(uint64_t programHash, const SimulatorConfig& config, const std::string& run) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hashBytes(hash, &kSimulatorVersion, sizeof(kSimulatorVersion));
+    hash = hashBytes(hash, &programHash, sizeof(programHash));
+    uint64_t settings = configHash(config);
+    hash = hashBytes(hash, &settings, sizeof(settings));
+    return hashBytes(hash, run.data(), run.size());
+}
+
+std::string ResultCache::path(uint64_t key) const {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.rvrc", static_cast<unsigned long long>(key));
+    return directory_ + "/" + name;
+}
+
+// Reads the entry in `data`, leaving the traces pointing into it.
+static bool parseEntry(const unsigned char* data, size_t size, uint64_t key, SimulatorStats& stats,
+                       std::vector<std::string_view>& traces) {
+    size_t offset = 4;
+    auto take = [&](int bytes, uint64_t& value) {
+        if (size - offset < static_cast<size_t>(bytes)) return false;
+        value = getLE(data + offset, bytes);
+        offset += bytes;
+        return true;
+    };
+
+    uint64_t version, storedKey, count;
+    if (size < 4 || std::memcmp(data, "RVRC", 4) != 0) return false;
+    if (!take(4, version) || version != kFormatVersion || !take(8, storedKey) || storedKey != key ||
+        !take(4, count) || count != kStatCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < kStatCount; i++) {
+        if (!take(8, stats.*kStatFields[i])) return false;
+    }
+
+    if (!take(4, count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t length;
+        if (!take(8, length) || length > size - offset) return false;
+        traces.push_back(std::string_view(reinterpret_cast<const char*>(data + offset), length));
+        offset += length;
+    }
+    return true;
+}
+
+bool ResultCache::lookup(uint64_t key, CachedResult& result) const {
+    result.release();
+    int fd = open(path(key).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    result.mapping_ = mapping;
+    result.size_ = info.st_size;
+    if (!parseEntry(static_cast<const unsigned char*>(mapping), result.size_, key, result.stats_, result.traces_)) {
+        result.release();
+        return false;
+    }
+    return true;
+}
+
+bool ResultCache::store(uint64_t key, const SimulatorStats& stats, const std::vector<std::string>& traces) const {
+    if (mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST) return false;
+
+    std::string entry = path(key);
+    // Unique per process and per call, as explorer threads store in parallel.
+    static std::atomic<unsigned> stores(0);
+    std::string temporary = entry + "." + std::to_string(getpid()) + "." + std::to_string(stores++) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        if (!out) return false;
+        out.write("RVRC", 4);
+        putLE(out, kFormatVersion, 4);
+        putLE(out, key, 8);
+        putLE(out, kStatCount, 4);
+        for (uint32_t i = 0; i < kStatCount; i++) putLE(out, stats.*kStatFields[i], 8);
+        putLE(out, traces.size(), 4);
+        for (const std::string& trace : traces) {
+            putLE(out, trace.size(), 8);
+            out.write(trace.data(), trace.size());
+        }
+        if (!out) {
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), entry.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
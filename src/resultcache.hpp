@@ -0,0 +1,67 @@
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include "simulator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A cached result read back by ResultCache::lookup.  The entry file stays
+// mapped while the object lives, and the traces point straight into it.
+class CachedResult {
+public:
+    CachedResult() : mapping_(nullptr), size_(0) {}
+    ~CachedResult() { release(); }
+    CachedResult(const CachedResult&) = delete;
+    CachedResult& operator=(const CachedResult&) = delete;
+
+    const SimulatorStats& stats() const { return stats_; }
+    size_t traceCount() const { return traces_.size(); }
+    std::string_view trace(size_t i) const { return traces_[i]; }
+
+private:
+    friend class ResultCache;
+    void release();
+
+    void* mapping_;
+    size_t size_;
+    SimulatorStats stats_;
+    std::vector<std::string_view> traces_;
+};
+
+// Persistent store of simulation results, one file per entry in
+// `directory`.  An entry is keyed by the program, the full configuration,
+// kSimulatorVersion and a description of how long the run was, and holds the
+// run's statistics plus any number of trace texts the caller chooses to keep.
+//
+// Entry file layout (little-endian):
+//     char[4]  magic "RVRC"
+//     uint32   format version (1)
+//     uint64   key
+//     uint32   statistic count, then that many uint64 statistics
+//     uint32   trace count, then per trace a uint64 length and its bytes
+//
+// Entries are written to a temporary file and renamed into place, so
+// concurrent runs sharing a directory never see a partial entry.  A missing,
+// truncated or foreign file is simply a miss.
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& directory) : directory_(directory) {}
+
+    // `run` distinguishes runs of the same program and configuration that
+    // stop at different points or report different things, e.g. "cycles=60".
+    static uint64_t key(uint64_t programHash, const SimulatorConfig& config, const std::string& run);
+
+    bool lookup(uint64_t key, CachedResult& result) const;
+    bool store(uint64_t key, const SimulatorStats& stats, const std::vector<std::string>& traces) const;
+
+private:
+    std::string path(uint64_t key) const;
+
+    std::string directory_;
+};
+
+#endif
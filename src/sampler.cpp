@@ -0,0 +1,256 @@
+#include "dse.hpp"
+#include "intervals.hpp"
+#include "options.hpp"
+#include "parsenumber.hpp"
+#include "phases.hpp"
+#include "threadpool.hpp"
+
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// The value of a numeric flag, which must lie in [min, max]; a bad one is
+// reported.
+static bool readNumber(const char* text, long long min, long long max, const std::string& what, long long& value) {
+    if (parseNumber(text, min, max, value)) return true;
+    std::cerr << "Error: bad " << what << " " << text << std::endl;
+    return false;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Simulates the first `instructions` instructions of the workload in one
+// piece, or all of them when the program ends.
+static SimulatorStats simulateWhole(const Workload& workload, const SimulatorConfig& config, uint64_t instructions,
+                                    bool ended) {
+    SimulatorConfig untraced = config;
+    untraced.traceEnabled = false;
+    Simulator sim(untraced);
+    workload.prepare(sim);
+    const Processor& cpu = sim.processor();
+    while (!sim.halted() && (ended || static_cast<uint64_t>(cpu.instructionsExecuted) < instructions)) sim.step();
+    return sim.stats();
+}
+
+// Prints the actual error of `cpi` against a run in one piece.
+static void checkEstimate(const Workload& workload, const SimulatorConfig& config, uint64_t instructions, bool ended,
+                          double cpi) {
+    auto started = std::chrono::steady_clock::now();
+    SimulatorStats whole = simulateWhole(workload, config, instructions, ended);
+    double error = whole.cpi() ? (cpi - whole.cpi()) / whole.cpi() : 0.0;
+    std::cout << "Sequential: " << whole.cycles << " cycles, " << whole.instructionsRetired << " instructions, CPI "
+              << std::setprecision(4) << whole.cpi() << ", actual error " << std::setprecision(3) << 100.0 * error
+              << "%, " << std::setprecision(2) << secondsSince(started) << " s" << std::endl;
+}
+
+// SimPoint: profiles basic-block vectors functionally, clusters the intervals
+// into phases and simulates one interval per phase in detail.
+static int runSimulationPoints(const Workload& workload, const Processor& start, const SimulatorConfig& config,
+                               uint64_t instructions, const IntervalSettings& settings, size_t phases, uint64_t seed,
+                               unsigned threads, bool check, const std::string& bbvFile,
+                               const std::string& outputFile) {
+    auto started = std::chrono::steady_clock::now();
+    BasicBlockProfile profile(settings.length);
+    uint64_t executed = profileBasicBlocks(start, instructions, profile);
+    bool ended = executed < instructions;
+    std::vector<SimulationPoint> points = chooseSimulationPoints(profile, phases, seed);
+    uint64_t interval = profile.interval();   // at least 1, whatever --interval said
+
+    std::vector<uint64_t> positions;
+    uint64_t lastEnd = 0;
+    for (const SimulationPoint& point : points) {
+        uint64_t first = point.interval * interval;
+        positions.push_back(first > settings.warmup ? first - settings.warmup : 0);
+        lastEnd = first + profile.instructions(point.interval);
+    }
+    std::vector<ArchCheckpoint> checkpoints;
+    bool lastEnded;
+    takeCheckpoints(start, positions, lastEnd, checkpoints, lastEnded);
+
+    std::vector<IntervalResult> results(points.size());
+    WorkStealingPool pool(threads);
+    pool.run(points.size(), [&](size_t p) {
+        uint64_t first = points[p].interval * interval;
+        uint64_t end = first + profile.instructions(points[p].interval);
+        bool drain = ended && points[p].interval + 1 == profile.vectors().size();
+        results[p] = simulateInterval(start.instMem, checkpoints[p], config, settings, first, end, end, drain);
+    });
+    double elapsed = secondsSince(started);
+
+    double cpi = 0.0;
+    uint64_t simulated = 0;
+    std::cout << "Functional profile: " << executed << " instructions" << (ended ? " (program ended)" : "") << ", "
+              << profile.vectors().size() << " intervals of " << interval << ", " << profile.blocks()
+              << " basic blocks" << std::endl;
+    std::cout << "Simulation points (" << points.size() << " phases):" << std::endl;
+    for (size_t p = 0; p < points.size(); p++) {
+        const SimulatorStats& stats = results[p].stats;
+        cpi += points[p].weight * stats.cpi();
+        simulated += stats.instructionsRetired;
+        std::cout << "  interval " << points[p].interval << " at instruction " << points[p].interval * interval
+                  << ": weight " << std::fixed << std::setprecision(4) << points[p].weight << " ("
+                  << points[p].members << " intervals), CPI " << stats.cpi()
+                  << (results[p].complete ? "" : " (did not finish)") << std::endl;
+    }
+    std::cout << "Estimated CPI " << cpi << " from " << simulated << " of " << executed
+              << " instructions simulated in detail, " << std::setprecision(2) << elapsed << " s" << std::endl;
+    if (check) checkEstimate(workload, config, executed, ended, cpi);
+
+    if (!bbvFile.empty()) {
+        std::ofstream out(bbvFile);
+        if (!out) {
+            std::cerr << "Error opening basic-block vector file: " << bbvFile << std::endl;
+            return 1;
+        }
+        profile.write(out);
+    }
+    if (!outputFile.empty()) {
+        std::ofstream out(outputFile);
+        if (!out) {
+            std::cerr << "Error opening output file: " << outputFile << std::endl;
+            return 1;
+        }
+        out << "interval,first,members,weight,instructions,cycles,cpi\n";
+        for (size_t p = 0; p < points.size(); p++) {
+            const SimulatorStats& stats = results[p].stats;
+            out << points[p].interval << "," << points[p].interval * interval << "," << points[p].members
+                << "," << std::setprecision(6) << points[p].weight << "," << stats.instructionsRetired << ","
+                << stats.cycles << "," << std::setprecision(4) << stats.cpi() << "\n";
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Workload workload;
+    bool haveWorkload = false;
+    DriverOptions options(true);
+    IntervalSettings settings;
+    uint64_t instructions = 1000000;
+    unsigned threads = 0;
+    bool check = false;
+    size_t phases = 0;
+    uint64_t seed = 1;
+    std::string bbvFile;
+    std::string outputFile;
+    long long number;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string error;
+        if (arg == "--instructions" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 1, LLONG_MAX, "instruction count", number)) return 1;
+            instructions = number;
+        } else if (arg == "--interval" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 1, LLONG_MAX, "interval length", number)) return 1;
+            settings.length = number;
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "warm-up length", number)) return 1;
+            settings.warmup = number;
+        } else if (arg == "--overlap" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "overlap length", number)) return 1;
+            settings.overlap = number;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, 1024, "thread count", number)) return 1;
+            threads = number;
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (arg == "--simpoints" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "simulation point count", number)) return 1;
+            phases = number;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            if (!readNumber(argv[++i], 0, LLONG_MAX, "seed", number)) return 1;
+            seed = number;
+        } else if (arg == "--bbv" && i + 1 < argc) {
+            bbvFile = argv[++i];
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            // Anything else configures the machine as it does for forward.
+            std::string name = arg.substr(2);
+            std::string value;
+            if (!isSwitchOption(name)) {
+                if (i + 1 >= argc) {
+                    std::cerr << "Error: missing value for " << arg << std::endl;
+                    return 1;
+                }
+                value = argv[++i];
+            }
+            if (!setOption(options, name, value, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+        } else if (!haveWorkload) {
+            if (!parseWorkload(arg, workload, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            haveWorkload = true;
+        } else {
+            std::cerr << "Error: only one workload can be sampled" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string error;
+    if (!haveWorkload) {
+        std::cerr << "Usage: " << argv[0] << " <program>[:x<n>=<value>...][:@<data>] [--instructions <n>] "
+                  << "[--interval <n>] [--warmup <n>] [--overlap <n>] [--threads <n>] [--out <file>] "
+                  << "[--check] [--simpoints <k>] [--seed <n>] [--bbv <file>] [machine options as for forward]"
+                  << std::endl;
+        return 1;
+    }
+    if (!validateOptions(options, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    const SimulatorConfig& config = options.simulator;
+    Simulator sim(config);
+    workload.prepare(sim);
+    if (phases > 0) {
+        return runSimulationPoints(workload, sim.processor(), config, instructions, settings, phases, seed, threads,
+                                   check, bbvFile, outputFile);
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    IntervalRun run = simulateIntervals(sim.processor(), config, instructions, settings, threads);
+    double elapsed = secondsSince(started);
+
+    size_t incomplete = 0;
+    for (const IntervalResult& interval : run.intervals) incomplete += interval.complete ? 0 : 1;
+
+    std::cout << "Functional pass: " << run.instructions << " instructions"
+              << (run.ended ? " (program ended)" : "") << ", " << run.intervals.size() << " intervals of "
+              << settings.length << " with " << settings.warmup << " warm-up" << std::endl;
+    std::cout << "Merged: " << run.total.cycles << " cycles, " << run.total.instructionsRetired
+              << " instructions, CPI " << std::fixed << std::setprecision(4) << run.total.cpi() << std::endl;
+    std::cout << "Boundary error estimate: " << run.boundaryCycles << " cycles over "
+              << (run.intervals.empty() ? 0 : run.intervals.size() - 1) << " boundaries, "
+              << std::setprecision(3) << 100.0 * run.cpiError() << "% of CPI" << std::endl;
+    if (incomplete) std::cout << "Warning: " << incomplete << " intervals did not finish" << std::endl;
+    std::cout << "Interval simulation: " << std::setprecision(2) << elapsed << " s" << std::endl;
+
+    if (check) checkEstimate(workload, config, run.instructions, run.ended, run.total.cpi());
+
+    if (!outputFile.empty()) {
+        std::ofstream out(outputFile);
+        if (!out) {
+            std::cerr << "Error opening output file: " << outputFile << std::endl;
+            return 1;
+        }
+        out << "first,instructions,cycles,cpi,head_cycles,overlap_cycles,complete\n";
+        for (const IntervalResult& interval : run.intervals) {
+            out << interval.first << "," << interval.stats.instructionsRetired << "," << interval.stats.cycles << ","
+                << std::setprecision(4) << interval.stats.cpi() << "," << interval.headCycles << ","
+                << interval.overlapCycles << "," << interval.complete << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "simulator.hpp"
+#include "loader.hpp"
+#include "pipeline.hpp"
+
+#include <algorithm>
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+template <typename T>
+static uint64_t hashValue(uint64_t hash, const T& value) {
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+static const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+uint64_t programHash(const InstructionMemory& program) {
+    uint64_t hash = hashValue(kHashSeed, program.parcels.size());
+    return program.parcels.empty() ? hash
+                                   : hashBytes(hash, program.parcels.data(), program.parcels.size() * 2);
+}
+
+uint64_t configHash(const SimulatorConfig& config) {
+    const CoreConfig& core = config.core;
+    uint64_t hash = kHashSeed;
+    hash = hashValue(hash, config.forwarding);
+    hash = hashValue(hash, config.dataMemorySize);
+    hash = hashValue(hash, core.fetchQueueDepth);
+    hash = hashValue(hash, core.icacheSize);
+    hash = hashValue(hash, core.icacheLineSize);
+    hash = hashValue(hash, core.icacheMissLatency);
+    hash = hashValue(hash, core.loadUseLatency);
+    hash = hashValue(hash, core.earlyLoadAddress);
+    hash = hashValue(hash, core.fusionIdioms);
+    hash = hashValue(hash, core.loadValuePrediction);
+    hash = hashValue(hash, core.loadAddressPrediction);
+    hash = hashValue(hash, core.loadPredictorEntries);
+    hash = hashValue(hash, core.loopBufferSize);
+    return hash;
+}
+
+Simulator::Simulator(const SimulatorConfig& config) : config_(config), cycle_(cycleFunction(config.forwarding)) {
+    reset();
+}
+
+bool Simulator::loadProgram(const std::string& filename) {
+    InstructionMemory instMem;
+    if (!::loadProgram(filename, instMem)) return false;
+
+    cpu_.instMem = instMem;
+    storedTrace_.reset();
+    cpu_.replaySource = nullptr;
+    reset();
+    return true;
+}
+
+void Simulator::loadProgram(const std::vector<uint32_t>& words) {
+    cpu_.instMem = InstructionMemory();
+    for (uint32_t word : words) cpu_.instMem.appendWord(word);
+    storedTrace_.reset();
+    cpu_.replaySource = nullptr;
+    reset();
+}
+
+void Simulator::loadExecutionTrace(std::shared_ptr<const ExecutionTrace> trace) {
+    storedTrace_.reset(new StoredTraceSource(trace));
+    cpu_.instMem = trace->program;
+    cpu_.replaySource = storedTrace_.get();
+    reset();
+}
+
+void Simulator::replayFrom(TraceSource* source) {
+    storedTrace_.reset();
+    cpu_.replaySource = source;
+}
+
+void Simulator::configure(const SimulatorConfig& config) {
+    config_ = config;
+    cycle_ = cycleFunction(config.forwarding);
+    reset();
+}
+
+void Simulator::reset() {
+    cpu_.core = config_.core;
+    cpu_.reset();
+    cpu_.regFile = RegisterFile();
+    cpu_.dataMem = DataMemory(config_.dataMemorySize);
+    cpu_.traceEnabled = config_.traceEnabled;
+
+    if (cpu_.traceEnabled) initPipelineTrace(cpu_);
+    else cpu_.clearInstructionTraces();
+
+    if (history_) {
+        history_->clear();
+        history_->record(cpu_);
+    }
+}
+
+uint64_t Simulator::step(uint64_t cycles) {
+    cpu_.stopRequested = false;
+    uint64_t executed = 0;
+    while (executed < cycles && !cpu_.stopRequested) {
+        cycle_(cpu_);
+        if (history_) history_->maybeRecord(cpu_);
+        executed++;
+    }
+    return executed;
+}
+
+uint64_t Simulator::run(uint64_t maxCycles) {
+    cpu_.stopRequested = false;
+    uint64_t executed = 0;
+    while (executed < maxCycles && !cpu_.halted() && !cpu_.stopRequested) {
+        cycle_(cpu_);
+        if (history_) history_->maybeRecord(cpu_);
+        executed++;
+    }
+    return executed;
+}
+
+void Simulator::addObserver(PipelineObserver* observer) {
+    cpu_.observers.push_back(observer);
+}
+
+void Simulator::removeObserver(PipelineObserver* observer) {
+    cpu_.observers.erase(std::remove(cpu_.observers.begin(), cpu_.observers.end(), observer),
+                         cpu_.observers.end());
+}
+
+void Simulator::writeRegister(int reg, int32_t value) {
+    cpu_.regFile.write(reg, value);
+    if (history_) history_->discardAfter(cpu_.clockCycle - 1);
+}
+
+void Simulator::writeMemory(uint32_t address, int32_t value, int size) {
+    cpu_.dataMem.write(address, value, size);
+    if (history_) history_->discardAfter(cpu_.clockCycle - 1);
+}
+
+void Simulator::redirect(uint32_t pc) {
+    cpu_.ifId = IF_ID_Register();
+    cpu_.idEx = ID_EX_Register();
+    cpu_.exMem = EX_MEM_Register();
+    cpu_.memWb = MEM_WB_Register();
+    cpu_.fetchQueue.clear();
+    cpu_.hazardUnit.clear();
+    cpu_.loopBuffer.stop();
+    cpu_.pc = pc;
+    if (history_) history_->discardAfter(cpu_.clockCycle - 1);
+}
+
+void Simulator::enableHistory(int interval) {
+    history_.reset(new SnapshotHistory(interval));
+    history_->record(cpu_);
+}
+
+void Simulator::goToCycle(uint64_t cycle) {
+    uint64_t current = cpu_.clockCycle;
+    if (cycle >= current) {
+        while (static_cast<uint64_t>(cpu_.clockCycle) < cycle) step(cycle - cpu_.clockCycle);
+        return;
+    }
+
+    if (!history_ || !history_->restoreNearest(cpu_, cycle)) reset();
+    while (static_cast<uint64_t>(cpu_.clockCycle) < cycle) step(cycle - cpu_.clockCycle);
+}
+
+// Adds `sign` times each counter of `other` to `stats`.
+static void combineStats(SimulatorStats& stats, const SimulatorStats& other, uint64_t sign) {
+    stats.cycles += sign * other.cycles;
+    stats.instructionsRetired += sign * other.instructionsRetired;
+    stats.stallCycles += sign * other.stallCycles;
+    stats.branchFlushes += sign * other.branchFlushes;
+    stats.loadUseStalls += sign * other.loadUseStalls;
+    stats.fusedPairs += sign * other.fusedPairs;
+    stats.loadsExecuted += sign * other.loadsExecuted;
+    stats.loadPredictions += sign * other.loadPredictions;
+    stats.loadMispredicts += sign * other.loadMispredicts;
+    stats.fetchWords += sign * other.fetchWords;
+    stats.instructionsFetched += sign * other.instructionsFetched;
+    stats.compressedFetched += sign * other.compressedFetched;
+    stats.fetchStarvedCycles += sign * other.fetchStarvedCycles;
+    stats.icacheAccesses += sign * other.icacheAccesses;
+    stats.icacheMisses += sign * other.icacheMisses;
+    stats.loopBufferReplays += sign * other.loopBufferReplays;
+    stats.loopFlushesAvoided += sign * other.loopFlushesAvoided;
+}
+
+SimulatorStats& SimulatorStats::operator+=(const SimulatorStats& other) {
+    combineStats(*this, other, 1);
+    return *this;
+}
+
+SimulatorStats& SimulatorStats::operator-=(const SimulatorStats& other) {
+    combineStats(*this, other, static_cast<uint64_t>(-1));
+    return *this;
+}
+
+SimulatorStats Simulator::stats() const {
+    SimulatorStats stats;
+    stats.cycles = cpu_.clockCycle;
+    stats.instructionsRetired = cpu_.instructionsExecuted;
+    stats.stallCycles = cpu_.stallCycles;
+    stats.branchFlushes = cpu_.branchFlushes;
+    stats.loadUseStalls = cpu_.loadUseStalls;
+    for (int i = 0; i < FUSION_KIND_COUNT; i++) stats.fusedPairs += cpu_.fusedPairs[i];
+    stats.loadsExecuted = cpu_.loadsExecuted;
+    stats.loadPredictions = cpu_.loadValuePredictions + cpu_.loadAddressPredictions;
+    stats.loadMispredicts = cpu_.loadMispredicts;
+    stats.fetchWords = cpu_.fetchWords;
+    stats.instructionsFetched = cpu_.instructionsFetched;
+    stats.compressedFetched = cpu_.compressedFetched;
+    stats.fetchStarvedCycles = cpu_.fetchStarvedCycles;
+    stats.icacheAccesses = cpu_.icacheAccesses;
+    stats.icacheMisses = cpu_.icacheMisses;
+    stats.loopBufferReplays = cpu_.loopBufferReplays;
+    stats.loopFlushesAvoided = cpu_.loopFlushesAvoided;
+    return stats;
+}
+
+ProcessorSnapshot Simulator::snapshot() const {
+    ProcessorSnapshot snapshot;
+    cpu_.saveSnapshot(snapshot);
+    return snapshot;
+}
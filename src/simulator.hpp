@@ -0,0 +1,204 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include "processor.hpp"
+#include "history.hpp"
+#include "observer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SimulatorConfig {
+    bool forwarding;
+    size_t dataMemorySize;
+    bool traceEnabled;
+    CoreConfig core;
+
+    SimulatorConfig() : forwarding(true), dataMemorySize(1024), traceEnabled(true) {}
+};
+
+struct SimulatorStats {
+    uint64_t cycles;
+    uint64_t instructionsRetired;
+    uint64_t stallCycles;
+    uint64_t branchFlushes;
+    uint64_t loadUseStalls;
+    uint64_t fusedPairs;
+    uint64_t loadsExecuted;
+    uint64_t loadPredictions;
+    uint64_t loadMispredicts;
+    uint64_t fetchWords;
+    uint64_t instructionsFetched;
+    uint64_t compressedFetched;
+    uint64_t fetchStarvedCycles;
+    uint64_t icacheAccesses;
+    uint64_t icacheMisses;
+    uint64_t loopBufferReplays;
+    uint64_t loopFlushesAvoided;
+
+    SimulatorStats() : cycles(0), instructionsRetired(0), stallCycles(0), branchFlushes(0), loadUseStalls(0),
+                       fusedPairs(0), loadsExecuted(0), loadPredictions(0), loadMispredicts(0), fetchWords(0),
+                       instructionsFetched(0), compressedFetched(0), fetchStarvedCycles(0), icacheAccesses(0),
+                       icacheMisses(0), loopBufferReplays(0), loopFlushesAvoided(0) {}
+
+    // Field by field, for merging the statistics of separate stretches of a
+    // run or taking the part between two readings.
+    SimulatorStats& operator+=(const SimulatorStats& other);
+    SimulatorStats& operator-=(const SimulatorStats& other);
+
+    double cpi() const {
+        return instructionsRetired ? static_cast<double>(cycles) / instructionsRetired : 0.0;
+    }
+
+    // Share of the retired instructions that retired as half of a fused pair.
+    double fusionRate() const {
+        return instructionsRetired ? 2.0 * fusedPairs / instructionsRetired : 0.0;
+    }
+
+    // Share of loads whose value was predicted, and share of those
+    // predictions that were right.
+    double loadPredictionCoverage() const {
+        return loadsExecuted ? static_cast<double>(loadPredictions) / loadsExecuted : 0.0;
+    }
+    double loadPredictionAccuracy() const {
+        return loadPredictions ? 1.0 - static_cast<double>(loadMispredicts) / loadPredictions : 0.0;
+    }
+
+    // Fetch bandwidth saved against 32-bit code, which needs one word per
+    // instruction fetched.
+    double fetchBandwidthSaved() const {
+        return instructionsFetched ? 1.0 - static_cast<double>(fetchWords) / instructionsFetched : 0.0;
+    }
+
+    // Share of the instructions entering IF/ID that the loop buffer supplied
+    // instead of the fetch unit and decoder.
+    double loopBufferCoverage() const {
+        uint64_t delivered = instructionsFetched + loopBufferReplays;
+        return delivered ? static_cast<double>(loopBufferReplays) / delivered : 0.0;
+    }
+};
+
+// Stable 64-bit digests of a loaded program and of everything in a
+// configuration that affects timing or results, for keying cached results.
+uint64_t programHash(const InstructionMemory& program);
+uint64_t configHash(const SimulatorConfig& config);
+
+// Folds `size` bytes into a running FNV-1a digest.  Callers feed fields one
+// at a time so padding never reaches the digest.
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size);
+
+// Bumped whenever a change alters timing, statistics or trace output, so a
+// result cached by an older build is never returned for a newer one.
+const uint32_t kSimulatorVersion = 2;
+
+// Read-only window onto a live processor.  It holds references, so it stays
+// current as the simulator steps and costs nothing to create.
+struct PipelineView {
+    const uint32_t& pc;
+    const IF_ID_Register& ifId;
+    const ID_EX_Register& idEx;
+    const EX_MEM_Register& exMem;
+    const MEM_WB_Register& memWb;
+    const RegisterFile& regFile;
+    const int& clockCycle;
+
+    explicit PipelineView(const Processor& cpu)
+        : pc(cpu.pc), ifId(cpu.ifId), idEx(cpu.idEx), exMem(cpu.exMem),
+          memWb(cpu.memWb), regFile(cpu.regFile), clockCycle(cpu.clockCycle) {}
+};
+
+// In-process driver around a Processor.  A harness loads a program once,
+// configures the machine and then steps or runs it as often as it likes
+// without going through files or a separate process.
+class Simulator {
+public:
+    explicit Simulator(const SimulatorConfig& config = SimulatorConfig());
+
+    bool loadProgram(const std::string& filename);
+    void loadProgram(const std::vector<uint32_t>& words);
+
+    // Timing-only replay of a recorded execution (see exectrace.hpp).  Loads
+    // the trace's program; from then on branch outcomes, data addresses and
+    // loaded values come from the trace, and the registers and data memory
+    // are left alone.  Loading a program returns to executing it.
+    void loadExecutionTrace(std::shared_ptr<const ExecutionTrace> trace);
+    bool replaying() const { return cpu_.replaySource != nullptr; }
+
+    // Replays records as `source` produces them, for a program already
+    // loaded and without resetting; nullptr returns to executing it.  The
+    // source is not owned and must outlive its use.
+    void replayFrom(TraceSource* source);
+
+    // The replayed program fetched an instruction the trace has no record
+    // for at that point; the run stopped there and drains.
+    bool replayDiverged() const { return cpu_.replayDiverged; }
+
+    const SimulatorConfig& config() const { return config_; }
+    void configure(const SimulatorConfig& config);
+
+    // Returns the machine to cycle 0 with the loaded program, cleared
+    // registers and a fresh data memory.
+    void reset();
+
+    // Advance by n cycles; returns the number of cycles actually executed,
+    // which is smaller when an observer asked to stop.
+    uint64_t step(uint64_t cycles = 1);
+
+    // Run until the pipeline drains past the end of the program, an observer
+    // asks to stop or the cycle budget is exhausted.  Returns the number of
+    // cycles executed.
+    uint64_t run(uint64_t maxCycles);
+    bool stopRequested() const { return cpu_.stopRequested; }
+
+    // Observers are not owned and must outlive their registration.
+    void addObserver(PipelineObserver* observer);
+    void removeObserver(PipelineObserver* observer);
+
+    bool halted() const { return cpu_.halted(); }
+
+    uint32_t pc() const { return cpu_.pc; }
+    int32_t readRegister(int reg) const { return cpu_.regFile.read(reg); }
+    void writeRegister(int reg, int32_t value);
+    int32_t readMemory(uint32_t address, int size) const { return cpu_.dataMem.read(address, size); }
+    void writeMemory(uint32_t address, int32_t value, int size);
+
+    // Squash everything in flight and restart fetch at pc.
+    void redirect(uint32_t pc);
+
+    SimulatorStats stats() const;
+
+    PipelineView view() const { return PipelineView(cpu_); }
+
+    // Copy-on-write snapshots: only the registers and latches are copied,
+    // memory pages are shared until written.
+    ProcessorSnapshot snapshot() const;
+    void restore(const ProcessorSnapshot& snapshot) { cpu_.restoreSnapshot(snapshot); }
+
+    // Reverse execution.  With history enabled a checkpoint is kept every
+    // `interval` cycles and goToCycle() restores the nearest one at or before
+    // the target and replays forward, so going back costs at most one
+    // interval of simulation.  Without history it replays from reset.
+    void enableHistory(int interval);
+    void disableHistory() { history_.reset(); }
+    const SnapshotHistory* history() const { return history_.get(); }
+    void goToCycle(uint64_t cycle);
+
+    void writePipelineTraceTXT(std::ostream& out) const { cpu_.outputPipelineTraceTXT(out); }
+    void writePipelineTraceCSV(std::ostream& out) const { cpu_.outputPipelineTraceCSV(out); }
+    void printPipelineTrace(std::ostream& out) const { cpu_.printTerminalTrace(out); }
+
+    Processor& processor() { return cpu_; }
+    const Processor& processor() const { return cpu_; }
+
+private:
+    SimulatorConfig config_;
+    // stepCycle specialized for config_.forwarding, picked on configuration.
+    void (*cycle_)(Processor& cpu);
+    Processor cpu_;
+    std::unique_ptr<StoredTraceSource> storedTrace_;
+    std::unique_ptr<SnapshotHistory> history_;
+};
+
+#endif
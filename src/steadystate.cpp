@@ -0,0 +1,238 @@
+#include "steadystate.hpp"
+#include "functional.hpp"
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// Records kept behind the release point, which bounds the loop iterations
+// that can be recognised.
+static const size_t kHistory = 4096;
+
+// Records checked ahead in one skip.  A loop longer than this is skipped in
+// several steps, each confirmed afresh.
+static const size_t kMaxSkipRecords = 1 << 16;
+
+// Earlier visits remembered per backward branch, so that a loop whose
+// iterations alternate between a few timings still settles.
+static const size_t kVisitsPerBranch = 4;
+
+// Every counter a cycle can advance.  clockCycle and instructionsExecuted
+// come first so the budgets can find them.
+static int PipelineState::* const kCounters[] = {
+    &PipelineState::clockCycle, &PipelineState::instructionsExecuted, &PipelineState::stallCycles,
+    &PipelineState::branchFlushes, &PipelineState::loadUseStalls, &PipelineState::loadsExecuted,
+    &PipelineState::loadValuePredictions, &PipelineState::loadAddressPredictions, &PipelineState::loadMispredicts,
+    &PipelineState::fetchWords, &PipelineState::instructionsFetched, &PipelineState::compressedFetched,
+    &PipelineState::fetchStarvedCycles, &PipelineState::icacheAccesses, &PipelineState::icacheMisses,
+    &PipelineState::loopBufferReplays, &PipelineState::loopFlushesAvoided,
+};
+
+static const size_t kCycles = 0, kRetired = 1;
+
+struct Visit {
+    std::vector<int64_t> key;
+    size_t cursor;
+    std::vector<int64_t> counters;
+};
+
+static void readCounters(const Processor& cpu, std::vector<int64_t>& counters) {
+    counters.clear();
+    for (int PipelineState::* counter : kCounters) counters.push_back(cpu.*counter);
+    for (int i = 0; i < FUSION_KIND_COUNT; i++) counters.push_back(cpu.fusedPairs[i]);
+    for (uint64_t cycles : cpu.fetchQueueOccupancy) counters.push_back(cycles);
+}
+
+static void advanceCounters(Processor& cpu, const std::vector<int64_t>& delta, int64_t times) {
+    size_t i = 0;
+    for (int PipelineState::* counter : kCounters) cpu.*counter += times * delta[i++];
+    for (int kind = 0; kind < FUSION_KIND_COUNT; kind++) cpu.fusedPairs[kind] += times * delta[i++];
+    for (uint64_t& cycles : cpu.fetchQueueOccupancy) cycles += times * delta[i++];
+}
+
+static void addLatch(std::vector<int64_t>& key, bool valid, uint32_t pc, const Instruction& inst,
+                     const Bubble& bubble) {
+    key.push_back(valid);
+    key.push_back(valid ? pc : bubble.pc);
+    key.push_back(valid ? static_cast<int>(inst.fusion) : static_cast<int>(bubble.cause));
+}
+
+// Everything that decides the timing of the cycles ahead when the records
+// replayed from here on are known.  Cycle numbers are taken relative to the
+// current cycle and record positions relative to replayCursor.
+static void timingSignature(const Processor& cpu, std::vector<int64_t>& key) {
+    int64_t cycle = cpu.clockCycle;
+    int64_t cursor = cpu.replayCursor;
+    key.clear();
+
+    key.push_back(cpu.pc);
+    key.push_back(cpu.fetchBuffer.pc);
+    key.push_back(cpu.fetchBuffer.count);
+    key.push_back(cpu.fetchQueue.size());
+    for (const IF_ID_Register& queued : cpu.fetchQueue) {
+        addLatch(key, queued.valid, queued.pc, queued.instruction, queued.bubble);
+    }
+
+    addLatch(key, cpu.ifId.valid, cpu.ifId.pc, cpu.ifId.instruction, cpu.ifId.bubble);
+    addLatch(key, cpu.idEx.valid, cpu.idEx.pc, cpu.idEx.instruction, cpu.idEx.bubble);
+    if (cpu.idEx.valid) {
+        key.push_back(cpu.idEx.control.branch);
+        key.push_back(cpu.idEx.control.jump);
+        key.push_back(static_cast<int64_t>(cpu.idEx.replayIndex) - cursor);
+    }
+    addLatch(key, cpu.exMem.valid, cpu.exMem.pc, cpu.exMem.instruction, cpu.exMem.bubble);
+    if (cpu.exMem.valid) {
+        key.push_back(cpu.exMem.control.branch);
+        key.push_back(cpu.exMem.control.jump);
+        key.push_back(cpu.exMem.branchTaken);
+        key.push_back(static_cast<int64_t>(cpu.exMem.replayIndex) - cursor);
+    }
+    addLatch(key, cpu.memWb.valid, cpu.memWb.pc, cpu.memWb.instruction, cpu.memWb.bubble);
+
+    key.insert(key.end(), cpu.icache.tags.begin(), cpu.icache.tags.end());
+    key.push_back(std::max<int64_t>(cpu.icacheReadyCycle - cycle, 0));
+    for (int ready : cpu.hazardUnit.loadReadyCycle) {
+        key.push_back(ready ? std::max<int64_t>(ready - cycle, -1) : -2);
+    }
+
+    const LoopBuffer& loop = cpu.loopBuffer;
+    key.push_back(loop.mode);
+    key.push_back(loop.start);
+    key.push_back(loop.branchPc);
+    key.push_back(loop.complete);
+    key.push_back(loop.next);
+    key.push_back(loop.entries.size());
+    for (const IF_ID_Register& entry : loop.entries) key.push_back(entry.pc);
+
+    key.push_back(cpu.replayEnded);
+}
+
+// Records that the timing model cannot tell apart.
+static bool sameTiming(const TraceRecord* a, const TraceRecord* b) {
+    return a && b && a->pc == b->pc && a->flags == b->flags && (!a->taken() || a->target == b->target);
+}
+
+// Whether every record in [begin, end) is timed like the one `period`
+// before it.
+static bool periodic(FunctionalTraceSource& source, size_t begin, size_t end, size_t period) {
+    for (size_t index = begin; index < end; index++) {
+        if (!sameTiming(source.record(index), source.record(index - period))) return false;
+    }
+    return true;
+}
+
+// The machine is in the state it was in at `earlier`, one loop iteration
+// later.  Replaying the iteration's records again from here repeats its
+// cycles exactly, so each further iteration whose records match the last one
+// is skipped by adding the iteration's counter deltas.  The records read
+// while reaching this state reach back to the oldest one still in EX, and
+// ahead to the one after ID's, which a fused pair at ID looks at.  Returns
+// the iterations skipped.
+static uint64_t skipIterations(Processor& cpu, FunctionalTraceSource& source, const Visit& earlier,
+                               const std::vector<int64_t>& counters, uint64_t instructions, uint64_t maxCycles) {
+    size_t cursor = cpu.replayCursor;
+    size_t period = cursor - earlier.cursor;
+    if (period == 0 || period > kHistory / 2) return 0;
+
+    std::vector<int64_t> delta(counters.size());
+    for (size_t i = 0; i < counters.size(); i++) delta[i] = counters[i] - earlier.counters[i];
+    if (delta[kCycles] <= 0 || delta[kRetired] <= 0) return 0;
+
+    size_t oldest = cursor;
+    if (cpu.idEx.valid) oldest = std::min(oldest, cpu.idEx.replayIndex);
+    if (cpu.exMem.valid) oldest = std::min(oldest, cpu.exMem.replayIndex);
+    if (oldest < period || !periodic(source, oldest, cursor + 2, period)) return 0;
+
+    // The run must not reach a budget inside the skipped iterations.
+    uint64_t cycle = counters[kCycles], retired = counters[kRetired];
+    uint64_t times = 0;
+    while ((times + 1) * period <= kMaxSkipRecords &&
+           cycle + (times + 1) * static_cast<uint64_t>(delta[kCycles]) < maxCycles &&
+           retired + (times + 1) * static_cast<uint64_t>(delta[kRetired]) < instructions &&
+           periodic(source, cursor + 2 + times * period, cursor + 2 + (times + 1) * period, period)) {
+        times++;
+    }
+    if (times == 0) return 0;
+
+    advanceCounters(cpu, delta, times);
+    int64_t cycles = times * delta[kCycles];
+    for (int& ready : cpu.hazardUnit.loadReadyCycle) {
+        if (ready) ready += cycles;
+    }
+    if (cpu.icacheReadyCycle) cpu.icacheReadyCycle += cycles;
+
+    size_t records = times * period;
+    cpu.replayCursor += records;
+    if (cpu.idEx.valid) cpu.idEx.replayIndex += records;
+    if (cpu.exMem.valid) cpu.exMem.replayIndex += records;
+    return times;
+}
+
+static bool running(const Simulator& sim, uint64_t instructions, uint64_t maxCycles) {
+    const Processor& cpu = sim.processor();
+    return static_cast<uint64_t>(cpu.instructionsExecuted) < instructions && !sim.halted() &&
+           static_cast<uint64_t>(cpu.clockCycle) < maxCycles;
+}
+
+SteadyStateStats runWithExtrapolation(Simulator& sim, uint64_t instructions, uint64_t maxCycles) {
+    SteadyStateStats stats;
+    Processor& cpu = sim.processor();
+    bool predictLoads = cpu.core.loadValuePrediction != LOAD_PREDICT_NONE || cpu.core.loadAddressPrediction;
+    if (predictLoads || !cpu.observers.empty() || cpu.traceEnabled || sim.history() || sim.replaying() ||
+        cpu.clockCycle != 0) {
+        while (running(sim, instructions, maxCycles)) sim.step();
+        return stats;
+    }
+
+    FunctionalTraceSource source(cpu, kHistory);
+    sim.replayFrom(&source);
+
+    std::unordered_map<uint32_t, std::deque<Visit> > visits;
+    size_t lastBranch = SIZE_MAX;
+    Visit now;
+    while (running(sim, instructions, maxCycles)) {
+        sim.step();
+
+        // Look for a backward transfer ID has just taken.
+        if (!cpu.idEx.valid || cpu.idEx.replayIndex == lastBranch) continue;
+        lastBranch = cpu.idEx.replayIndex;
+        const TraceRecord* record = source.record(lastBranch);
+        if (!record || !record->taken() || record->target >= record->pc) continue;
+
+        timingSignature(cpu, now.key);
+        now.cursor = cpu.replayCursor;
+        readCounters(cpu, now.counters);
+
+        std::deque<Visit>& earlier = visits[record->pc];
+        uint64_t skipped = 0;
+        for (auto it = earlier.rbegin(); it != earlier.rend() && !skipped; ++it) {
+            if (it->key == now.key) {
+                skipped = skipIterations(cpu, source, *it, now.counters, instructions, maxCycles);
+            }
+        }
+        if (skipped) {
+            stats.extrapolations++;
+            stats.iterations += skipped;
+            stats.cycles += cpu.clockCycle - now.counters[kCycles];
+            stats.instructions += cpu.instructionsExecuted - now.counters[kRetired];
+            // Earlier visits elsewhere are now behind a gap in the records.
+            visits.clear();
+            lastBranch = cpu.idEx.replayIndex;
+            continue;
+        }
+
+        earlier.push_back(now);
+        if (earlier.size() > kVisitsPerBranch) earlier.pop_front();
+    }
+
+    // Registers hold what has written back, and data memory also the stores
+    // in MEM/WB.
+    sim.replayFrom(nullptr);
+    cpu.regFile = source.retired(cpu.instructionsExecuted).regFile;
+    size_t stored = cpu.memWb.valid ? (cpu.memWb.instruction.fusion != FUSE_NONE ? 2 : 1) : 0;
+    cpu.dataMem = source.retired(cpu.instructionsExecuted + stored).dataMem;
+    return stats;
+}
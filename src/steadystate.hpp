@@ -0,0 +1,42 @@
+#ifndef STEADYSTATE_HPP
+#define STEADYSTATE_HPP
+
+#include <cstdint>
+
+class Simulator;
+
+struct SteadyStateStats {
+    uint64_t extrapolations;   // times a steady state was entered and skipped ahead
+    uint64_t iterations;       // loop iterations skipped
+    uint64_t cycles;           // cycles covered by them
+    uint64_t instructions;     // instructions covered by them
+
+    SteadyStateStats() : extrapolations(0), iterations(0), cycles(0), instructions(0) {}
+};
+
+// Steps `sim` from cycle 0 until it has retired `instructions` instructions,
+// halted or reached `maxCycles` cycles, with the same final cycle count,
+// statistics and architectural state as stepping it one cycle at a time, but
+// skips ahead through loops whose timing has settled.
+//
+// The timing model replays records that a FunctionalTraceSource executes on
+// demand.  Whenever ID takes a backward branch or jump, the timing state is
+// reduced to a signature: the fetch PC and buffer, the fetch queue, the PCs
+// and control state in the latches, the instruction cache tags, the loop
+// buffer, the load-use timers relative to the current cycle and the latches'
+// record positions relative to ID's.  Data values are left out, because in
+// replay no timing decision reads them.  When a signature recurs at the same
+// branch, the machine is in the same state one loop iteration later.  If the
+// next iterations execute the same PCs with the same branch outcomes, each
+// one therefore takes exactly as many cycles and adds exactly as much to
+// every counter as the last.  Those iterations are executed architecturally
+// only, and the cycle count, the counters and the replay positions are
+// advanced by whole iterations.  A budget is never crossed inside a skip, so
+// the run still stops where stepping would.
+//
+// The load predictors train on data values, so with one enabled, as with an
+// observer attached, the stage table on or a checkpoint history kept, the run
+// is stepped normally.
+SteadyStateStats runWithExtrapolation(Simulator& sim, uint64_t instructions, uint64_t maxCycles);
+
+#endif
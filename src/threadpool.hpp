@@ -0,0 +1,78 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a batch of independent tasks on a group of worker threads.  The tasks
+// are dealt round-robin into one deque per worker; a worker takes its next
+// task from the back of its own deque and, once that is empty, steals from
+// the front of the others.  Long and short tasks therefore balance out
+// without every worker contending for one shared queue.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads)
+        : threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    unsigned threads() const { return threads_; }
+
+    // Calls task(i) for every i in [0, count) and returns once all are done.
+    void run(size_t count, const std::function<void(size_t)>& task) {
+        size_t workers = std::min<size_t>(threads_, count);
+        if (workers <= 1) {
+            for (size_t i = 0; i < count; i++) task(i);
+            return;
+        }
+
+        std::vector<std::unique_ptr<Queue> > queues;
+        for (size_t w = 0; w < workers; w++) queues.emplace_back(new Queue());
+        for (size_t i = 0; i < count; i++) queues[i % workers]->tasks.push_back(i);
+
+        std::vector<std::thread> pool;
+        for (size_t w = 0; w < workers; w++) {
+            pool.emplace_back([&queues, &task, w, workers]() {
+                size_t index;
+                while (take(*queues[w], false, index) || steal(queues, w, workers, index)) task(index);
+            });
+        }
+        for (std::thread& thread : pool) thread.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    static bool take(Queue& queue, bool fromFront, size_t& index) {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) return false;
+        if (fromFront) {
+            index = queue.tasks.front();
+            queue.tasks.pop_front();
+        } else {
+            index = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        return true;
+    }
+
+    // No task is ever added once the workers start, so a full round of
+    // empty victims means the batch is drained.
+    static bool steal(std::vector<std::unique_ptr<Queue> >& queues, size_t self, size_t workers, size_t& index) {
+        for (size_t offset = 1; offset < workers; offset++) {
+            if (take(*queues[(self + offset) % workers], true, index)) return true;
+        }
+        return false;
+    }
+
+    unsigned threads_;
+};
+
+#endif
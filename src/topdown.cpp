@@ -0,0 +1,53 @@
+#include "topdown.hpp"
+
+#include <iomanip>
+
+uint64_t TopDownAccounting::Counts::slots() const {
+    uint64_t sum = retiring;
+    for (int i = 0; i < BUBBLE_CAUSE_COUNT; i++) sum += bubbles[i];
+    return sum;
+}
+
+void TopDownAccounting::onRetire(Processor& cpu, const MEM_WB_Register& retired) {
+    total_.retiring++;
+    regions_[retired.pc - retired.pc % regionSize_].retiring++;
+}
+
+void TopDownAccounting::onBubble(Processor& cpu, const Bubble& bubble) {
+    total_.bubbles[bubble.cause]++;
+    // Fill bubbles belong to no instruction.
+    if (bubble.cause != BUBBLE_FILL) regions_[bubble.pc - bubble.pc % regionSize_].bubbles[bubble.cause]++;
+}
+
+static void printLine(std::ostream& out, const char* name, uint64_t count, uint64_t slots) {
+    out << std::left << std::setw(22) << name << std::right << std::setw(10) << count << std::setw(9)
+        << std::fixed << std::setprecision(1) << (slots ? 100.0 * count / slots : 0.0) << "%\n";
+}
+
+void TopDownAccounting::writeReport(std::ostream& out) const {
+    uint64_t slots = total_.slots();
+    out << "WB slots: " << slots << "\n";
+    printLine(out, "retiring", total_.retiring, slots);
+    printLine(out, "frontend bound", total_.frontend(), slots);
+    printLine(out, "  pipeline fill", total_.bubbles[BUBBLE_FILL], slots);
+    printLine(out, "  fetch starvation", total_.bubbles[BUBBLE_FETCH_STARVED], slots);
+    printLine(out, "bad speculation", total_.badSpeculation(), slots);
+    printLine(out, "  branch flush", total_.bubbles[BUBBLE_BRANCH_FLUSH], slots);
+    printLine(out, "  value mispredict", total_.bubbles[BUBBLE_VALUE_MISPREDICT], slots);
+    printLine(out, "backend bound", total_.backend(), slots);
+    printLine(out, "  data hazard", total_.bubbles[BUBBLE_DATA_HAZARD], slots);
+    printLine(out, "  memory", total_.bubbles[BUBBLE_MEMORY], slots);
+    printLine(out, "  structural", total_.bubbles[BUBBLE_STRUCTURAL], slots);
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+
+    out << "\nregion_start,region_end,retiring,fetch_starvation,branch_flush,value_mispredict,data_hazard,memory,structural\n";
+    for (const auto& entry : regions_) {
+        const Counts& counts = entry.second;
+        out << "0x" << std::hex << std::setw(8) << std::setfill('0') << entry.first << ",0x" << std::setw(8)
+            << entry.first + regionSize_ - 1 << std::dec << std::setfill(' ') << "," << counts.retiring << ","
+            << counts.bubbles[BUBBLE_FETCH_STARVED] << "," << counts.bubbles[BUBBLE_BRANCH_FLUSH] << ","
+            << counts.bubbles[BUBBLE_VALUE_MISPREDICT] << "," << counts.bubbles[BUBBLE_DATA_HAZARD] << "," << counts.bubbles[BUBBLE_MEMORY] << ","
+            << counts.bubbles[BUBBLE_STRUCTURAL] << "\n";
+    }
+}
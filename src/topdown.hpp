@@ -0,0 +1,54 @@
+#ifndef TOPDOWN_HPP
+#define TOPDOWN_HPP
+
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+
+// Top-down accounting of the WB slot.  Every cycle the slot either retires an
+// instruction or holds a bubble, and the bubble carries the cause recorded
+// where it entered the pipeline:
+//
+//   retiring
+//   frontend bound    pipeline fill, fetch starvation
+//   bad speculation   branch flush (fetch redirect), load value mispredict
+//   backend bound     data hazard, memory, structural
+//
+// Slots are also charged to PC regions of `regionSize` bytes: a retiring slot
+// to the retiring instruction, a bubble to the instruction that caused it.
+class TopDownAccounting : public PipelineObserver {
+public:
+    explicit TopDownAccounting(uint32_t regionSize = 32) : regionSize_(regionSize ? regionSize : 4) {}
+
+    void onRetire(Processor& cpu, const MEM_WB_Register& retired) override;
+    void onBubble(Processor& cpu, const Bubble& bubble) override;
+
+    struct Counts {
+        uint64_t retiring = 0;
+        uint64_t bubbles[BUBBLE_CAUSE_COUNT] = {};
+
+        uint64_t slots() const;
+        uint64_t frontend() const { return bubbles[BUBBLE_FILL] + bubbles[BUBBLE_FETCH_STARVED]; }
+        uint64_t badSpeculation() const {
+            return bubbles[BUBBLE_BRANCH_FLUSH] + bubbles[BUBBLE_VALUE_MISPREDICT];
+        }
+        uint64_t backend() const {
+            return bubbles[BUBBLE_DATA_HAZARD] + bubbles[BUBBLE_MEMORY] + bubbles[BUBBLE_STRUCTURAL];
+        }
+    };
+
+    const Counts& total() const { return total_; }
+    const std::map<uint32_t, Counts>& regions() const { return regions_; }
+
+    void writeReport(std::ostream& out) const;
+
+private:
+    uint32_t regionSize_;
+    Counts total_;
+    std::map<uint32_t, Counts> regions_;   // keyed by region start address
+};
+
+#endif
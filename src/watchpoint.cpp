@@ -0,0 +1,82 @@
+#include "watchpoint.hpp"
+
+bool WatchpointSet::add(uint32_t address, uint32_t length, Kind kind, Action action) {
+    if (length > UINT32_MAX - address) return false;
+    Watchpoint watchpoint;
+    watchpoint.begin = address;
+    watchpoint.end = address + (length ? length : 1);
+    watchpoint.kind = kind;
+    watchpoint.action = action;
+    watchpoints_.push_back(watchpoint);
+    rebuildPageBits();
+    return true;
+}
+
+bool WatchpointSet::remove(uint32_t address, uint32_t length, Kind kind) {
+    if (length > UINT32_MAX - address) return false;
+    uint32_t end = address + (length ? length : 1);
+    for (size_t i = 0; i < watchpoints_.size(); i++) {
+        if (watchpoints_[i].begin == address && watchpoints_[i].end == end && watchpoints_[i].kind == kind) {
+            watchpoints_.erase(watchpoints_.begin() + i);
+            rebuildPageBits();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WatchpointSet::clear() {
+    watchpoints_.clear();
+    pageBits_.clear();
+    hitPending_ = false;
+}
+
+void WatchpointSet::rebuildPageBits() {
+    pageBits_.clear();
+    for (const auto& watchpoint : watchpoints_) {
+        uint32_t first = watchpoint.begin >> DataMemory::kPageBits;
+        uint32_t last = (watchpoint.end - 1) >> DataMemory::kPageBits;
+        for (uint32_t page = first; page <= last; page++) {
+            if (page / 64 >= pageBits_.size()) pageBits_.resize(page / 64 + 1, 0);
+            pageBits_[page / 64] |= 1ull << (page % 64);
+        }
+    }
+}
+
+void WatchpointSet::onMemoryAccess(Processor& cpu, const MemoryAccess& access) {
+    uint32_t first = access.address >> DataMemory::kPageBits;
+    uint32_t last = (access.address + access.size - 1) >> DataMemory::kPageBits;
+    if (!pageWatched(first) && !pageWatched(last)) return;
+
+    uint32_t end = access.address + access.size;
+    for (const auto& watchpoint : watchpoints_) {
+        if (!(watchpoint.kind & (access.isWrite ? WATCH_WRITE : WATCH_READ))) continue;
+        if (access.address < watchpoint.end && watchpoint.begin < end) {
+            if (watchpoint.action == LOG) {
+                logHits_++;
+                if (log_) log_->append(access);
+                continue;
+            }
+            lastHit_.watchpoint = watchpoint;
+            lastHit_.access = access;
+            hitPending_ = true;
+            cpu.stopRequested = true;
+            return;
+        }
+    }
+}
+
+void BreakpointSet::insert(uint32_t pc) {
+    if (test(pc)) return;
+    uint32_t half = pc / 2;
+    if (half / 64 >= bits_.size()) bits_.resize(half / 64 + 1, 0);
+    bits_[half / 64] |= 1ull << (half % 64);
+    count_++;
+}
+
+void BreakpointSet::erase(uint32_t pc) {
+    if (!test(pc)) return;
+    uint32_t half = pc / 2;
+    bits_[half / 64] &= ~(1ull << (half % 64));
+    count_--;
+}
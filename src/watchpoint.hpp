@@ -0,0 +1,91 @@
+#ifndef WATCHPOINT_HPP
+#define WATCHPOINT_HPP
+
+#include "memtrace.hpp"
+#include "observer.hpp"
+#include "processor.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Address-range watchpoints on DataMemory.  A bitmap with one bit per data
+// memory page rejects accesses to unwatched pages before the range list is
+// searched.  A STOP watchpoint records the hit and requests a stop; a LOG
+// watchpoint appends the access to the attached log and lets the run go on.
+class WatchpointSet : public PipelineObserver {
+public:
+    enum Kind {
+        WATCH_WRITE = 1, WATCH_READ = 2, WATCH_ACCESS = WATCH_READ | WATCH_WRITE
+    };
+
+    enum Action {
+        STOP, LOG
+    };
+
+    struct Watchpoint {
+        uint32_t begin, end;   // [begin, end)
+        Kind kind;
+        Action action;
+    };
+
+    struct Hit {
+        Watchpoint watchpoint;
+        MemoryAccess access;
+    };
+
+    WatchpointSet() : hitPending_(false), log_(nullptr), logHits_(0) {}
+
+    // Both return false for a range that runs past the end of the address
+    // space.
+    bool add(uint32_t address, uint32_t length, Kind kind, Action action = STOP);
+    bool remove(uint32_t address, uint32_t length, Kind kind);
+    void clear();
+    bool empty() const { return watchpoints_.empty(); }
+
+    bool hitPending() const { return hitPending_; }
+    const Hit& lastHit() const { return lastHit_; }
+    void clearHit() { hitPending_ = false; }
+
+    // Destination of LOG hits; not owned.
+    void setLog(MemoryAccessLog* log) { log_ = log; }
+    uint64_t logHits() const { return logHits_; }
+
+    void onMemoryAccess(Processor& cpu, const MemoryAccess& access) override;
+
+private:
+    void rebuildPageBits();
+    bool pageWatched(uint32_t page) const {
+        return page / 64 < pageBits_.size() && (pageBits_[page / 64] >> (page % 64)) & 1;
+    }
+
+    std::vector<Watchpoint> watchpoints_;
+    std::vector<uint64_t> pageBits_;
+    bool hitPending_;
+    Hit lastHit_;
+    MemoryAccessLog* log_;
+    uint64_t logHits_;
+};
+
+// One bit per instruction halfword, the granularity at which compressed
+// instructions can start, so testing a PC is a shift and a mask.
+class BreakpointSet {
+public:
+    BreakpointSet() : count_(0) {}
+
+    bool any() const { return count_ > 0; }
+
+    bool test(uint32_t pc) const {
+        uint32_t half = pc / 2;
+        return half / 64 < bits_.size() && (bits_[half / 64] >> (half % 64)) & 1;
+    }
+
+    void insert(uint32_t pc);
+    void erase(uint32_t pc);
+    void clear() { bits_.clear(); count_ = 0; }
+
+private:
+    std::vector<uint64_t> bits_;
+    size_t count_;
+};
+
+#endif